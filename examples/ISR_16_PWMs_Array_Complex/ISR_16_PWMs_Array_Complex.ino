@@ -36,6 +36,15 @@
 // Default is true, uncomment to false
 //#define CHANGING_PWM_END_OF_CYCLE     false
 
+// Default is false, uncomment to register the timer ISR in IRAM. Only with a core built with CONFIG_ARDUINO_ISR_IRAM,
+// which puts micros() and digitalWrite(), called by ISR_PWM.run(), in IRAM
+//#define USING_IRAM_TIMER_ISR          true
+
+// Max timer interrupt entry latency, in timer ticks ( us )
+volatile uint32_t maxISRLatency = 0;
+
+#define TIMER_ISR_LATENCY_HOOK(ticks)   { if ( (ticks) > maxISRLatency ) maxISRLatency = (ticks); }
+
 // To be included only in main(), .ino with setup() to avoid `Multiple Definitions` Linker Error
 #include "ESP32_PWM.h"
 
@@ -388,7 +397,8 @@ void simpleTimerDoingSomething2s()
 
   Serial.print(F("SimpleTimer (ms): ")); Serial.print(SIMPLE_TIMER_MS);
   Serial.print(F(", us : ")); Serial.print(currMicros);
-  Serial.print(F(", Dus : ")); Serial.println(currMicros - previousMicrosStart);
+  Serial.print(F(", Dus : ")); Serial.print(currMicros - previousMicrosStart);
+  Serial.print(F(", max ISR latency (us) : ")); Serial.println(maxISRLatency);
 
   for (uint16_t i = 0; i < NUMBER_ISR_PWMS; i++)
   {
@@ -183,18 +183,21 @@ void setup()
 
   // Just to demonstrate, don't use too many ISR Timers if not absolutely necessary
   // You can use up to 16 timer for each ISR_PWM
+#if USING_PWM_FREQUENCY
+
+  // Create all channels at once, with a common start instant
+  if (ISR_PWM.setPWMBatch(PWM_Pin, PWM_Freq, PWM_DutyCycle, NUMBER_ISR_PWMS) < 0)
+  {
+    Serial.println(F("setPWMBatch error"));
+  }
+
+#else
   for (uint16_t i = 0; i < NUMBER_ISR_PWMS; i++)
   //for (uint16_t i = 0; i < 1; i++)
   {
     //void setPWM(uint32_t pin, float frequency, float dutycycle
     // , timer_callback_p StartCallback = nullptr, timer_callback_p StopCallback = nullptr)
 
-#if USING_PWM_FREQUENCY
-
-    // You can use this with PWM_Freq in Hz
-    ISR_PWM.setPWM(PWM_Pin[i], PWM_Freq[i], PWM_DutyCycle[i]);
-
-#else
   #if USING_MICROS_RESOLUTION
     // Or using period in microsecs resolution
     ISR_PWM.setPWM_Period(PWM_Pin[i], PWM_Period[i], PWM_DutyCycle[i]);
@@ -202,8 +205,8 @@ void setup()
     // Or using period in millisecs resolution
     ISR_PWM.setPWM_Period(PWM_Pin[i], PWM_Period[i] / 1000, PWM_DutyCycle[i]);
   #endif
-#endif
   }
+#endif
 }
 
 void loop()
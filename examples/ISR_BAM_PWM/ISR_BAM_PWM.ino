@@ -0,0 +1,126 @@
+/****************************************************************************************************************************
+  ISR_BAM_PWM.ino
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+  
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers. 
+  The timer counters can be configured to count up or down and support automatic reload and software reload. 
+  They can also generate alarms when they reach a specific value, defined by the software. 
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+*****************************************************************************************************************************/
+
+// Bit-Angle Modulation (BAM) demo. The ISR cost per tick is constant, whatever the number of channels.
+// With 8-bit resolution and 20us ticks, one BAM frame is 255 * 20us = 5.1ms, or 196Hz
+
+#if !defined( ESP32 )
+  #error This code is designed to run on ESP32 platform, not Arduino nor ESP8266! Please check your Tools->Board setting.
+#endif
+
+// These define's must be placed at the beginning before #include "ESP32_PWM.h"
+// _PWM_LOGLEVEL_ from 0 to 4
+// Don't define _PWM_LOGLEVEL_ > 0. Only for special ISR debugging only. Can hang the system.
+#define _PWM_LOGLEVEL_                3
+
+// From 8 to 12. Each extra bit doubles the frame length
+#define BAM_RESOLUTION_BITS           8
+
+// To be included only in main(), .ino with setup() to avoid `Multiple Definitions` Linker Error
+#include "ESP32_PWM.h"
+
+#ifndef LED_BUILTIN
+  #define LED_BUILTIN       2
+#endif
+
+#define HW_TIMER_INTERVAL_US      20L
+
+uint32_t startMicros = 0;
+
+// Init ESP32 timer 1
+ESP32Timer ITimer(1);
+
+// Init ESP32_BAM_PWM
+ESP32_BAM_PWM ISR_BAM;
+
+bool IRAM_ATTR TimerHandler(void * timerNo)
+{
+  ISR_BAM.run();
+
+  return true;
+}
+
+//////////////////////////////////////////////////////
+
+#if ( ARDUINO_ESP32C3_DEV )
+  #define NUMBER_BAM_CHANNELS     4
+
+  uint32_t BAM_Pin[] = { LED_BUILTIN, 3, 4, 5 };
+#else
+  #define NUMBER_BAM_CHANNELS     8
+
+  uint32_t BAM_Pin[] = { LED_BUILTIN, 4, 5, 12, 13, 14, 15, 16 };
+#endif
+
+int BAM_Channel[NUMBER_BAM_CHANNELS];
+
+////////////////////////////////////////////////
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial);
+
+  delay(2000);
+
+  Serial.print(F("\nStarting ISR_BAM_PWM on ")); Serial.println(ARDUINO_BOARD);
+  Serial.println(ESP32_PWM_VERSION);
+  Serial.print(F("CPU Frequency = ")); Serial.print(F_CPU / 1000000); Serial.println(F(" MHz"));
+
+  // Interval in microsecs
+  if (ITimer.attachInterruptInterval(HW_TIMER_INTERVAL_US, TimerHandler))
+  {
+    startMicros = micros();
+    Serial.print(F("Starting ITimer OK, micros() = ")); Serial.println(startMicros);
+  }
+  else
+    Serial.println(F("Can't set ITimer. Select another freq. or timer"));
+
+  for (uint16_t i = 0; i < NUMBER_BAM_CHANNELS; i++)
+  {
+    BAM_Channel[i] = ISR_BAM.setChannel(BAM_Pin[i], (BAM_MAX_DUTY * (i + 1)) / NUMBER_BAM_CHANNELS);
+  }
+
+  // All channels start together at the next BAM frame
+  ISR_BAM.publish();
+}
+
+////////////////////////////////////////////////
+
+void loop()
+{
+  static uint16_t step = 0;
+
+  // Breathing pattern, all channels updated in the same frame
+  for (uint16_t i = 0; i < NUMBER_BAM_CHANNELS; i++)
+  {
+    ISR_BAM.setDuty(BAM_Channel[i], (step + i * (BAM_MAX_DUTY / NUMBER_BAM_CHANNELS)) % (BAM_MAX_DUTY + 1));
+  }
+
+  ISR_BAM.publish();
+
+  step = (step + 1) % (BAM_MAX_DUTY + 1);
+
+  delay(10);
+}
@@ -109,6 +109,9 @@ void setup()
   else
     Serial.println(F("Can't set ITimer. Select another freq. or timer"));
 
+  // No ITimer interrupt while no PWM channel needs it, e.g. between deleteChannel() and setPWM()
+  ISR_PWM.attachTimer(&ITimer);
+
   // Just to demonstrate, don't use too many ISR Timers if not absolutely necessary
   // You can use up to 16 timer for each ISR_PWM
   //void setPWM(uint32_t pin, uint32_t frequency, uint32_t dutycycle
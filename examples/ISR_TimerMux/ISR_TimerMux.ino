@@ -0,0 +1,134 @@
+/****************************************************************************************************************************
+  ISR_TimerMux.ino
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+  
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers. 
+  The timer counters can be configured to count up or down and support automatic reload and software reload. 
+  They can also generate alarms when they reach a specific value, defined by the software. 
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+*****************************************************************************************************************************/
+
+// Timer multiplexer demo. The PWM engine, a 1ms control loop and one-shot alarms share one hardware timer,
+// leaving the other one free, e.g. on ESP32_C3 with only 2 timers
+
+#if !defined( ESP32 )
+  #error This code is designed to run on ESP32 platform, not Arduino nor ESP8266! Please check your Tools->Board setting.
+#endif
+
+// These define's must be placed at the beginning before #include "ESP32_PWM.h"
+// _PWM_LOGLEVEL_ from 0 to 4
+// Don't define _PWM_LOGLEVEL_ > 0. Only for special ISR debugging only. Can hang the system.
+#define _PWM_LOGLEVEL_                3
+
+#define USING_MICROS_RESOLUTION       true    //false
+
+// Default is true, uncomment to false
+//#define CHANGING_PWM_END_OF_CYCLE     false
+
+// Up to 64 alarms
+#define MAX_NUMBER_TIMER_MUX_ALARMS   8
+
+// To be included only in main(), .ino with setup() to avoid `Multiple Definitions` Linker Error
+#include "ESP32_PWM.h"
+
+#ifndef LED_BUILTIN
+  #define LED_BUILTIN       2
+#endif
+
+#define PIN_D4              4
+
+#define HW_TIMER_INTERVAL_US      20L
+
+// Init ESP32 timer 1, counting the alarms of all clients
+ESP32Timer ITimer(1);
+
+ESP32_TimerMux TimerMux;
+
+// Init ESP32_ISR_PWM, one client of TimerMux
+ESP32_PWM ISR_PWM;
+
+bool IRAM_ATTR TimerHandler(void * timerNo)
+{
+  TimerMux.run();
+
+  return true;
+}
+
+//////////////////////////////////////////////////////
+
+volatile uint32_t controlLoops  = 0;
+volatile uint32_t oneShots      = 0;
+
+void IRAM_ATTR ControlLoop(void * arg)
+{
+  controlLoops++;
+}
+
+void IRAM_ATTR OneShot(void * arg)
+{
+  oneShots++;
+}
+
+////////////////////////////////////////////////
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial);
+
+  delay(2000);
+
+  Serial.print(F("\nStarting ISR_TimerMux on ")); Serial.println(ARDUINO_BOARD);
+  Serial.println(ESP32_PWM_VERSION);
+  Serial.print(F("CPU Frequency = ")); Serial.print(F_CPU / 1000000); Serial.println(F(" MHz"));
+
+  if (TimerMux.begin(&ITimer, TimerHandler))
+  {
+    Serial.print(F("Starting TimerMux OK, micros() = ")); Serial.println(micros());
+  }
+  else
+    Serial.println(F("Can't set ITimer. Select another timer"));
+
+  // The PWM engine, serviced every HW_TIMER_INTERVAL_US
+  TimerMux.setInterval(HW_TIMER_INTERVAL_US, ESP32_TimerMux::runPWM, &ISR_PWM);
+
+  TimerMux.setInterval(1000, ControlLoop);
+
+  ISR_PWM.setPWM(LED_BUILTIN, 1.0f, 50.0f);
+  ISR_PWM.setPWM(PIN_D4, 100.0f, 25.0f);
+}
+
+////////////////////////////////////////////////
+
+void loop()
+{
+  static uint32_t lastMillis = 0;
+
+  if (millis() - lastMillis >= 1000)
+  {
+    lastMillis = millis();
+
+    // Once, 500us from now
+    TimerMux.setTimeout(500, OneShot);
+
+    Serial.print(F("Control loops = ")); Serial.print(controlLoops);
+    Serial.print(F(", one-shots = ")); Serial.print(oneShots);
+    Serial.print(F(", alarms = ")); Serial.print(TimerMux.getnumAlarms());
+    Serial.print(F(", max lateness (ns) = ")); Serial.print(TimerMux.getMaxLatenessNs());
+    Serial.print(F(", overruns = ")); Serial.println(TimerMux.getOverruns());
+  }
+}
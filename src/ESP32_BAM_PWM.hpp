@@ -0,0 +1,166 @@
+/****************************************************************************************************************************
+  ESP32_BAM_PWM.hpp
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+  
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers. 
+  The timer counters can be configured to count up or down and support automatic reload and software reload. 
+  They can also generate alarms when they reach a specific value, defined by the software. 
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+
+  Version: 1.3.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      20/09/2021 Initial coding for ESP32, ESP32_S2, ESP32_C3 boards with ESP32 core v2.0.0+
+  1.0.1   K Hoang      21/09/2021 Fix bug. Ading PWM end-of-duty-cycle callback function. Improve examples
+  1.1.0   K Hoang      06/11/2021 Add functions to modify PWM settings on-the-fly
+  1.1.1   K Hoang      09/11/2021 Fix examples to not use GPIO1/TX0 for core v2.0.1+
+  1.2.0   K Hoang      29/01/2022 Fix multiple-definitions linker error. Improve accuracy. Fix bug
+  1.2.1   K Hoang      30/01/2022 DutyCycle to be updated at the end current PWM period
+  1.2.2   K Hoang      01/02/2022 Use float for DutyCycle and Freq, uint32_t for period. Optimize code
+  1.3.0   K Hoang      12/02/2022 Add support to new ESP32-S3
+  1.3.1   K Hoang      04/03/2022 Fix `DutyCycle` and `New Period` display bugs. Display warning only when debug level > 3
+  1.3.2   K Hoang      09/05/2022 Remove crashing PIN_D24 from examples
+  1.3.3   K Hoang      16/06/2022 Add support to new Adafruit boards
+*****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef ESP32_BAM_PWM_HPP
+#define ESP32_BAM_PWM_HPP
+
+#include "ESP32_PWM_ISR.hpp"
+
+// Bit-Angle Modulation (BAM) : each channel's duty is split into binary-weighted bit planes.
+// Plane n lasts (1 << n) ticks, and the whole output state of that plane is one precomputed GPIO mask.
+// The ISR cost per plane is constant, no matter how many channels are used.
+
+#if !defined(BAM_RESOLUTION_BITS)
+  #define BAM_RESOLUTION_BITS         8
+#elif ( (BAM_RESOLUTION_BITS < 8) || (BAM_RESOLUTION_BITS > 12) )
+  #error BAM_RESOLUTION_BITS must be from 8 to 12
+#endif
+
+#if !defined(MAX_NUMBER_BAM_CHANNELS)
+  #define MAX_NUMBER_BAM_CHANNELS     32
+#elif (MAX_NUMBER_BAM_CHANNELS > 64)
+  #error MAX_NUMBER_BAM_CHANNELS must be <= 64
+#endif
+
+#define BAM_MAX_DUTY                  ( (1 << BAM_RESOLUTION_BITS) - 1 )
+
+// Ticks of one BAM frame. The BAM frequency is ( Hardware Timer frequency / BAM_FRAME_TICKS )
+#define BAM_FRAME_TICKS               BAM_MAX_DUTY
+
+#define BAM_ACTIVE_SET(state)         ( (state) & 0x01 )
+#define BAM_SWAP_PENDING              0x02
+
+class ESP32_BAM_PWM
+{
+  public:
+
+    // constructor
+    ESP32_BAM_PWM();
+
+    void init();
+
+    // To be called on every hardware timer tick. Only does real work once per bit plane
+    void IRAM_ATTR run();
+
+    // To be called once per bit plane, when the hardware timer is re-armed on every call.
+    // Returns the length of the plane just started, in ticks, to be used as next alarm interval
+    uint16_t IRAM_ATTR runPlane();
+
+    //////////////////////////////////////////////////////////////////
+
+    // duty from 0 to BAM_MAX_DUTY
+    // Return the channelNum if OK, -1 if error. The new channel is output after the next publish()
+    int setChannel(const uint32_t& pin, const uint16_t& duty = 0);
+
+    // Stage the new duty of a channel. Nothing changes on the pins until publish() is called
+    bool setDuty(const uint8_t& channelNum, const uint16_t& duty);
+
+    // dutycycle from 0.00 to 100.00
+    bool setDutyCycle(const uint8_t& channelNum, const float& dutycycle)
+    {
+      if ( (dutycycle < 0.0) || (dutycycle > 100.0) )
+      {
+        PWM_LOGERROR("Error: Invalid dutycycle");
+        return false;
+      }
+
+      return setDuty(channelNum, (uint16_t) ( ( BAM_MAX_DUTY * dutycycle ) / 100 ));
+    }
+
+    // Rebuild the bit planes of all staged duties into the back plane set, then hand it to the ISR.
+    // The ISR switches to the new plane set only at the start of the next frame, so all channels change together
+    void publish();
+
+    // destroy the specified BAM channel. The pin is driven LOW after the next publish()
+    void deleteChannel(const uint8_t& channelNum);
+
+    uint16_t getDuty(const uint8_t& channelNum)
+    {
+      return (channelNum < MAX_NUMBER_BAM_CHANNELS) ? BAM[channelNum].duty : 0;
+    }
+
+    // returns the number of used BAM channels
+    int8_t getnumChannels()
+    {
+      return numChannels;
+    }
+
+    // returns the number of available BAM channels
+    uint8_t getNumAvailableBAMChannels()
+    {
+      return MAX_NUMBER_BAM_CHANNELS - numChannels;
+    }
+
+  private:
+
+    // find the first available slot
+    int findFirstFreeSlot();
+
+    typedef struct
+    {
+      uint32_t      pin;                // BAM pin, INVALID_ESP32_PIN if slot is free
+      uint16_t      duty;               // from 0 to BAM_MAX_DUTY, staged until publish()
+    } BAM_t;
+
+    typedef struct
+    {
+      PWM_GPIO_Mask_t   planeMask[BAM_RESOLUTION_BITS];   // pins HIGH during each bit plane
+      PWM_GPIO_Mask_t   pinMask;                          // all pins driven by this plane set
+    } BAM_PlaneSet_t;
+
+    BAM_t           BAM[MAX_NUMBER_BAM_CHANNELS];
+
+    // Double-buffered plane sets. The ISR only reads planeSet[BAM_ACTIVE_SET(planeState)],
+    // the task only writes the other one, and only while BAM_SWAP_PENDING is cleared
+    BAM_PlaneSet_t  planeSet[2];
+
+    // bit 0 : active plane set, bit 1 : swap pending. Changed with atomic compare-and-swap only
+    volatile uint32_t planeState;
+
+    uint8_t         currentPlane;
+    uint16_t        ticksLeft;
+
+    // actual number of BAM channels in use (-1 means uninitialized)
+    int8_t          numChannels;
+};
+
+#endif    // ESP32_BAM_PWM_HPP
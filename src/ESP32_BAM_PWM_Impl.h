@@ -0,0 +1,264 @@
+/****************************************************************************************************************************
+  ESP32_BAM_PWM_Impl.h
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+  
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers. 
+  The timer counters can be configured to count up or down and support automatic reload and software reload. 
+  They can also generate alarms when they reach a specific value, defined by the software. 
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+
+  Version: 1.3.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      20/09/2021 Initial coding for ESP32, ESP32_S2, ESP32_C3 boards with ESP32 core v2.0.0+
+  1.0.1   K Hoang      21/09/2021 Fix bug. Ading PWM end-of-duty-cycle callback function. Improve examples
+  1.1.0   K Hoang      06/11/2021 Add functions to modify PWM settings on-the-fly
+  1.1.1   K Hoang      09/11/2021 Fix examples to not use GPIO1/TX0 for core v2.0.1+
+  1.2.0   K Hoang      29/01/2022 Fix multiple-definitions linker error. Improve accuracy. Fix bug
+  1.2.1   K Hoang      30/01/2022 DutyCycle to be updated at the end current PWM period
+  1.2.2   K Hoang      01/02/2022 Use float for DutyCycle and Freq, uint32_t for period. Optimize code
+  1.3.0   K Hoang      12/02/2022 Add support to new ESP32-S3
+  1.3.1   K Hoang      04/03/2022 Fix `DutyCycle` and `New Period` display bugs. Display warning only when debug level > 3
+  1.3.2   K Hoang      09/05/2022 Remove crashing PIN_D24 from examples
+  1.3.3   K Hoang      16/06/2022 Add support to new Adafruit boards
+*****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef ESP32_BAM_PWM_IMPL_H
+#define ESP32_BAM_PWM_IMPL_H
+
+#include <string.h>
+
+///////////////////////////////////////////////////
+
+ESP32_BAM_PWM::ESP32_BAM_PWM()
+  : planeState (0), currentPlane (BAM_RESOLUTION_BITS - 1), ticksLeft (1), numChannels (-1)
+{
+  // The ISR may already be running before init(). Output nothing until the first publish()
+  memset((void*) planeSet, 0, sizeof (planeSet));
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_BAM_PWM::init()
+{
+  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_BAM_CHANNELS; channelNum++)
+  {
+    BAM[channelNum].pin   = INVALID_ESP32_PIN;
+    BAM[channelNum].duty  = 0;
+  }
+
+  numChannels = 0;
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_BAM_PWM::run()
+{
+  // Nothing to do until the current bit plane is over
+  if (--ticksLeft == 0)
+  {
+    ticksLeft = runPlane();
+  }
+}
+
+///////////////////////////////////////////////////
+
+uint16_t IRAM_ATTR ESP32_BAM_PWM::runPlane()
+{
+  currentPlane = (currentPlane + 1 < BAM_RESOLUTION_BITS) ? currentPlane + 1 : 0;
+
+  uint32_t state = __atomic_load_n(&planeState, __ATOMIC_ACQUIRE);
+
+  // Only switch plane set at the start of a frame, so that every channel outputs a complete duty
+  if ( (currentPlane == 0) && (state & BAM_SWAP_PENDING) )
+  {
+    uint32_t newState = BAM_ACTIVE_SET(state) ^ 0x01;
+
+    // Pins deleted since the last publish() are no longer in the new pinMask. Drive them LOW once
+    PWM_GPIO_Mask_t removedMask = planeSet[BAM_ACTIVE_SET(state)].pinMask & ~planeSet[newState].pinMask;
+
+    // Fails only if publish() is just taking the back plane set back. Then keep the active one
+    if (__atomic_compare_exchange_n(&planeState, &state, newState, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      PWM_writeGPIOMask(0, removedMask);
+      state = newState;
+    }
+  }
+
+  const BAM_PlaneSet_t& activeSet = planeSet[BAM_ACTIVE_SET(state)];
+
+  PWM_GPIO_Mask_t onMask = activeSet.planeMask[currentPlane];
+
+  PWM_writeGPIOMask(onMask, activeSet.pinMask & ~onMask);
+
+  return (1 << currentPlane);
+}
+
+///////////////////////////////////////////////////
+
+// find the first available slot
+// return -1 if none found
+int ESP32_BAM_PWM::findFirstFreeSlot()
+{
+  // all slots are used
+  if (numChannels >= MAX_NUMBER_BAM_CHANNELS)
+  {
+    return -1;
+  }
+
+  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_BAM_CHANNELS; channelNum++)
+  {
+    if (BAM[channelNum].pin == INVALID_ESP32_PIN)
+    {
+      return channelNum;
+    }
+  }
+
+  // no free slots found
+  return -1;
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_BAM_PWM::setChannel(const uint32_t& pin, const uint16_t& duty)
+{
+  if ( (pin >= 64) || (duty > BAM_MAX_DUTY) )
+  {
+    PWM_LOGERROR("Error: Invalid pin or duty");
+    return -1;
+  }
+
+  if (numChannels < 0)
+  {
+    init();
+  }
+
+  int channelNum = findFirstFreeSlot();
+
+  if (channelNum < 0)
+  {
+    return -1;
+  }
+
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+
+  BAM[channelNum].pin   = pin;
+  BAM[channelNum].duty  = duty;
+
+  numChannels++;
+
+  PWM_LOGINFO_LINE("BAM Channel : ", channelNum,
+                   "\t    Pin : ", pin,
+                   "\t\tDuty : ", duty);
+
+  return channelNum;
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_BAM_PWM::setDuty(const uint8_t& channelNum, const uint16_t& duty)
+{
+  if ( (channelNum >= MAX_NUMBER_BAM_CHANNELS) || (numChannels <= 0) || (BAM[channelNum].pin == INVALID_ESP32_PIN) )
+  {
+    PWM_LOGERROR("Error: Invalid channelNum");
+    return false;
+  }
+
+  if (duty > BAM_MAX_DUTY)
+  {
+    PWM_LOGERROR("Error: Invalid duty");
+    return false;
+  }
+
+  BAM[channelNum].duty = duty;
+
+  return true;
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_BAM_PWM::publish()
+{
+  if (numChannels < 0)
+  {
+    init();
+  }
+
+  uint32_t state = __atomic_load_n(&planeState, __ATOMIC_ACQUIRE);
+
+  // If the previous publish() is not yet latched by the ISR, cancel it to get the back plane set back.
+  // If the ISR latches it meanwhile, state is reloaded and the new back plane set is the old active one
+  while ( (state & BAM_SWAP_PENDING) &&
+          !__atomic_compare_exchange_n(&planeState, &state, state & ~BAM_SWAP_PENDING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) )
+  {
+  }
+
+  uint32_t activeSet = BAM_ACTIVE_SET(state);
+
+  // The ISR doesn't read the back plane set until BAM_SWAP_PENDING is set again
+  BAM_PlaneSet_t& backSet = planeSet[activeSet ^ 0x01];
+
+  memset((void*) &backSet, 0, sizeof (BAM_PlaneSet_t));
+
+  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_BAM_CHANNELS; channelNum++)
+  {
+    if (BAM[channelNum].pin == INVALID_ESP32_PIN)
+    {
+      continue;
+    }
+
+    PWM_GPIO_Mask_t pinMask = PWM_GPIO_MASK(BAM[channelNum].pin);
+    uint16_t        duty    = BAM[channelNum].duty;
+
+    backSet.pinMask |= pinMask;
+
+    for (uint8_t plane = 0; plane < BAM_RESOLUTION_BITS; plane++)
+    {
+      if (duty & (1 << plane))
+      {
+        backSet.planeMask[plane] |= pinMask;
+      }
+    }
+  }
+
+  __atomic_store_n(&planeState, activeSet | BAM_SWAP_PENDING, __ATOMIC_RELEASE);
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_BAM_PWM::deleteChannel(const uint8_t& channelNum)
+{
+  // nothing to delete if no channels are in use
+  if ( (channelNum >= MAX_NUMBER_BAM_CHANNELS) || (numChannels <= 0) )
+  {
+    return;
+  }
+
+  if (BAM[channelNum].pin != INVALID_ESP32_PIN)
+  {
+    BAM[channelNum].pin   = INVALID_ESP32_PIN;
+    BAM[channelNum].duty  = 0;
+
+    numChannels--;
+  }
+}
+
+#endif    // ESP32_BAM_PWM_IMPL_H
@@ -46,6 +46,8 @@
 
 #include "ESP32_PWM.hpp"
 #include "ESP32_PWM_ISR.h"
+#include "ESP32_BAM_PWM_Impl.h"
+#include "ESP32_TimerMux_Impl.h"
 
 #endif    // ESP32_PWM_H
 
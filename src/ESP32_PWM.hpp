@@ -88,7 +88,20 @@
 
 #include "PWM_Generic_Debug.h"
 
+// Register the timer ISR with ESP_INTR_FLAG_IRAM, to be serviced even while the flash cache is disabled, and without
+// flash cache misses. The callback, and all it calls, including the PWM callbacks, must then be in IRAM.
+// ISR_PWM.run() calls micros() / millis() and digitalWrite(), which are only in IRAM when the core is built with
+// CONFIG_ARDUINO_ISR_IRAM. Without it, leave USING_IRAM_TIMER_ISR false for an ISR calling ISR_PWM.run()
+#if !defined(USING_IRAM_TIMER_ISR)
+  #define USING_IRAM_TIMER_ISR       false
+#endif
+
+// Instrumentation hook. Define TIMER_ISR_LATENCY_HOOK(ticks) as a function or macro, in IRAM if USING_IRAM_TIMER_ISR,
+// to be called before each callback with the interrupt entry latency, in timer ticks ( getDivider() / TIMER_BASE_CLK s )
+// since the alarm. Not for timers started by attachInterruptFreeRunning(), e.g. by ESP32_TimerMux
+
 #include <driver/timer.h>
+#include <hal/timer_ll.h>
 
 /*
   //ESP32 core v1.0.6, hw_timer_t defined in esp32/tools/sdk/include/driver/driver/timer.h:
@@ -189,10 +202,31 @@ typedef ESP32TimerInterrupt ESP32Timer;
   #define MAX_ESP32_NUM_TIMERS      4
 #endif
 
-#define TIMER_DIVIDER             80                                //  Hardware timer clock divider
+#if !defined(TIMER_DIVIDER)
+  #define TIMER_DIVIDER           80                                //  Hardware timer clock divider, 2 - 65536
+#endif
+
+#if (TIMER_DIVIDER < 2) || (TIMER_DIVIDER > 65536)
+  #error TIMER_DIVIDER must be 2 - 65536
+#endif
+
 // TIMER_BASE_CLK = APB_CLK_FREQ = Frequency of the clock on the input of the timer groups
 #define TIMER_SCALE               (TIMER_BASE_CLK / TIMER_DIVIDER)  // convert counter value to seconds
 
+// Divider picked by the timer for each interval : the largest one, up to TIMER_DIVIDER, counting the interval exactly
+#define TIMER_DIVIDER_AUTO        0
+
+// Number of timer ticks in ns nanoseconds, rounded, with the divider. Computed at compile time if both are constants
+constexpr uint64_t timerTicksFromNs(const uint64_t ns, const uint32_t divider)
+{
+  return ( ns * (TIMER_BASE_CLK / 1000000) + (uint64_t) divider * 500 ) / ( (uint64_t) divider * 1000 );
+}
+
+constexpr uint64_t timerTicksFromUs(const uint64_t us, const uint32_t divider)
+{
+  return timerTicksFromNs(us * 1000, divider);
+}
+
 
 // In esp32/1.0.6/tools/sdk/esp32s2/include/driver/include/driver/timer.h
 // typedef bool (*timer_isr_t)(void *);
@@ -204,6 +238,9 @@ typedef ESP32TimerInterrupt ESP32Timer;
 
 #define INVALID_ESP32_PIN         255
 
+// Alarm value never reached, to stop the interrupts without stopping the counter. 2^54 - 1 ticks are days at 40MHz
+#define TIMER_IDLE_ALARM_VALUE    0x003FFFFFFFFFFFFFULL
+
 typedef bool (*esp32_timer_callback)  (void *);
 
 // For ESP32_C3, TIMER_MAX == 1
@@ -241,13 +278,50 @@ class ESP32TimerInterrupt
     float             _frequency;       // Timer frequency
     uint64_t          _timerCount;      // count to activate timer
     
+    uint32_t          _divider;         // 2 - 65536, or TIMER_DIVIDER_AUTO
+    
     //xQueueHandle      s_timer_queue;
+    
+    // The largest divider, up to TIMER_DIVIDER, making ns a whole number of ticks. 2, the finest, if none
+    uint32_t selectDivider(const uint64_t& ns)
+    {
+      // ns in 1 / TIMER_BASE_CLK s
+      uint64_t baseTicks = ns * (TIMER_BASE_CLK / 1000000);
+      
+      if ( (baseTicks % 1000) == 0 )
+      {
+        baseTicks /= 1000;
+        
+        for (uint32_t divider = TIMER_DIVIDER; divider > 2; divider--)
+        {
+          if ( (baseTicks % divider) == 0 )
+          {
+            return divider;
+          }
+        }
+      }
+      
+      return 2;
+    }
 
   public:
 
-    ESP32TimerInterrupt(uint8_t timerNo)
+    // divider : 2 - 65536, the timer counting at TIMER_BASE_CLK / divider, e.g. 40MHz ( 25ns ) for 2, 
+    // or TIMER_DIVIDER_AUTO to pick one for each interval
+    ESP32TimerInterrupt(uint8_t timerNo, const uint32_t& divider = TIMER_DIVIDER)
     {     
       _callback = NULL;
+      
+      if ( (divider == TIMER_DIVIDER_AUTO) || ( (divider >= 2) && (divider <= 65536) ) )
+      {
+        _divider = divider;
+      }
+      else
+      {
+        PWM_LOGERROR1(F("Error. Invalid divider, using TIMER_DIVIDER ="), TIMER_DIVIDER);
+        
+        _divider = TIMER_DIVIDER;
+      }
         
       if (timerNo < MAX_ESP32_NUM_TIMERS)
       {
@@ -278,36 +352,75 @@ class ESP32TimerInterrupt
     // frequency (in hertz) and duration (in milliseconds). Duration = 0 or not specified => run indefinitely
     // No params and duration now. To be addes in the future by adding similar functions here or to esp32-hal-timer.c
     bool setFrequency(const float& frequency, esp32_timer_callback callback)
+    {
+      if (frequency <= 0)
+      {
+        PWM_LOGERROR(F("Error. Invalid frequency"));
+        
+        return false;
+      }
+      
+      if (_divider == TIMER_DIVIDER_AUTO)
+      {
+        return setIntervalNs( (uint64_t) (1000000000.0 / frequency), callback);
+      }
+      
+      return setTicks( (uint64_t) ( (TIMER_BASE_CLK / _divider) / frequency ), _divider, callback);
+    }
+    
+    // ticks of the timer, at TIMER_BASE_CLK / divider. With TIMER_DIVIDER_AUTO, the divider is TIMER_DIVIDER
+    // e.g. attachInterruptTicks(timerTicksFromNs(12500, 2), TimerHandler) for 12.5us, computed at compile time
+    bool attachInterruptTicks(const uint64_t& ticks, esp32_timer_callback callback)
+    {
+      return setTicks(ticks, (_divider == TIMER_DIVIDER_AUTO) ? TIMER_DIVIDER : _divider, callback);
+    }
+    
+    // interval in nanoseconds, rounded to the tick of the divider.
+    // The ISR still takes a few us, so that only intervals of many us are practical, but not only whole us, e.g. 12.5us
+    bool setIntervalNs(const uint64_t& ns, esp32_timer_callback callback)
+    {
+      uint32_t divider = (_divider == TIMER_DIVIDER_AUTO) ? selectDivider(ns) : _divider;
+      
+      return setTicks(timerTicksFromNs(ns, divider), divider, callback);
+    }
+    
+    bool setTicks(const uint64_t& ticks, const uint32_t& divider, esp32_timer_callback callback)
     {
       if (_timerNo < MAX_ESP32_NUM_TIMERS)
       {      
-        // select timer frequency is 1MHz for better accuracy. We don't use 16-bit prescaler for now.
-        // Will use later if very low frequency is needed.
-        _frequency  = TIMER_BASE_CLK / TIMER_DIVIDER;
-        _timerCount = (uint64_t) _frequency / frequency;
+        if (ticks == 0)
+        {
+          PWM_LOGERROR(F("Error. Interval shorter than one tick"));
+        
+          return false;
+        }
+      
+        // 1MHz by default, or up to TIMER_BASE_CLK / 2 for sub-us ticks
+        stdConfig.divider = divider;
+        _frequency  = TIMER_BASE_CLK / divider;
+        _timerCount = ticks;
         // count up
 
 #if USING_ESP32_S2_PWM
-        PWM_LOGWARN3(F("ESP32_S2_TimerInterrupt: _timerNo ="), _timerNo, F(", _fre ="), TIMER_BASE_CLK / TIMER_DIVIDER);
+        PWM_LOGWARN3(F("ESP32_S2_TimerInterrupt: _timerNo ="), _timerNo, F(", _fre ="), TIMER_BASE_CLK / divider);
 #elif USING_ESP32_S3_PWM
         // ESP32-S3 is embedded with four 54-bit general-purpose timers, which are based on 16-bit prescalers
         // and 54-bit auto-reload-capable up/down-timers
-        PWM_LOGWARN3(F("ESP32_S3_TimerInterrupt: _timerNo ="), _timerNo, F(", _fre ="), TIMER_BASE_CLK / TIMER_DIVIDER);   
+        PWM_LOGWARN3(F("ESP32_S3_TimerInterrupt: _timerNo ="), _timerNo, F(", _fre ="), TIMER_BASE_CLK / divider);   
 #else
-        PWM_LOGWARN3(F("ESP32_TimerInterrupt: _timerNo ="), _timerNo, F(", _fre ="), TIMER_BASE_CLK / TIMER_DIVIDER);
+        PWM_LOGWARN3(F("ESP32_TimerInterrupt: _timerNo ="), _timerNo, F(", _fre ="), TIMER_BASE_CLK / divider);
 #endif
  
-        PWM_LOGWARN3(F("TIMER_BASE_CLK ="), TIMER_BASE_CLK, F(", TIMER_DIVIDER ="), TIMER_DIVIDER);
+        PWM_LOGWARN3(F("TIMER_BASE_CLK ="), TIMER_BASE_CLK, F(", divider ="), divider);
         PWM_LOGWARN3(F("_timerIndex ="), _timerIndex, F(", _timerGroup ="), _timerGroup);
         PWM_LOGWARN3(F("_count ="), (uint32_t) (_timerCount >> 32) , F("-"), (uint32_t) (_timerCount));
-        PWM_LOGWARN1(F("timer_set_alarm_value ="), TIMER_SCALE / frequency);
 
         timer_init(_timerGroup, _timerIndex, &stdConfig);
         
         // Counter value to 0 => counting up to alarm value as .counter_dir == TIMER_COUNT_UP
         timer_set_counter_value(_timerGroup, _timerIndex , 0x00000000ULL);       
         
-        timer_set_alarm_value(_timerGroup, _timerIndex, TIMER_SCALE / frequency);
+        timer_set_alarm_value(_timerGroup, _timerIndex, _timerCount);
                
         // enable interrupts for _timerGroup, _timerIndex
         timer_enable_intr(_timerGroup, _timerIndex);
@@ -318,7 +431,19 @@ class ESP32TimerInterrupt
         // If the intr_alloc_flags value ESP_INTR_FLAG_IRAM is set, the handler function must be declared with IRAM_ATTR attribute
         // and can only call functions in IRAM or ROM. It cannot call other timer APIs.
        //timer_isr_register(_timerGroup, _timerIndex, _callback, (void *) (uint32_t) _timerNo, ESP_INTR_FLAG_IRAM, NULL);
-        timer_isr_callback_add(_timerGroup, _timerIndex, _callback, (void *) (uint32_t) _timerNo, 0);
+#if defined(TIMER_ISR_LATENCY_HOOK)
+        // A free-running counter is not reloaded at the alarm, so it's not the latency. No hook then
+        if (stdConfig.auto_reload == TIMER_AUTORELOAD_EN)
+        {
+          timer_isr_callback_add(_timerGroup, _timerIndex, latencyISR, (void *) this, 
+                                 USING_IRAM_TIMER_ISR ? ESP_INTR_FLAG_IRAM : 0);
+        }
+        else
+#endif
+        {
+          timer_isr_callback_add(_timerGroup, _timerIndex, _callback, (void *) (uint32_t) _timerNo, 
+                                 USING_IRAM_TIMER_ISR ? ESP_INTR_FLAG_IRAM : 0);
+        }
 
         timer_start(_timerGroup, _timerIndex);
   
@@ -340,19 +465,34 @@ class ESP32TimerInterrupt
     // No params and duration now. To be addes in the future by adding similar functions here or to esp32-hal-timer.c
     bool setInterval(const unsigned long& interval, esp32_timer_callback callback)
     {
-      return setFrequency((float) (1000000.0f / interval), callback);
+      return setIntervalNs( (uint64_t) interval * 1000, callback);
     }
 
     bool attachInterrupt(const float& frequency, esp32_timer_callback callback)
     {
       return setFrequency(frequency, callback);
     }
+    
+    // The counter is never reloaded, and counts the ticks since now, as a timebase read by getCounterFromISR().
+    // No interrupt until an absolute counter value is set by setAlarmFromISR(). For multiplexers, e.g. ESP32_TimerMux.
+    // TIMER_ISR_LATENCY_HOOK is not called, see ESP32_TimerMux::getMaxLatenessNs() instead
+    bool attachInterruptFreeRunning(esp32_timer_callback callback)
+    {
+      stdConfig.auto_reload = TIMER_AUTORELOAD_DIS;
+      
+      bool result = setTicks(TIMER_IDLE_ALARM_VALUE, (_divider == TIMER_DIVIDER_AUTO) ? TIMER_DIVIDER : _divider, callback);
+      
+      // The other attachInterrupt*() reload the counter, as before
+      stdConfig.auto_reload = TIMER_AUTORELOAD_EN;
+      
+      return result;
+    }
 
     // interval (in microseconds) and duration (in milliseconds). Duration = 0 or not specified => run indefinitely
     // No params and duration now. To be addes in the future by adding similar functions here or to esp32-hal-timer.c
     bool attachInterruptInterval(const unsigned long& interval, esp32_timer_callback callback)
     {
-      return setFrequency( (float) ( 1000000.0f / interval), callback);
+      return setIntervalNs( (uint64_t) interval * 1000, callback);
     }
 
     void detachInterrupt()
@@ -406,6 +546,79 @@ class ESP32TimerInterrupt
       timer_start(_timerGroup, _timerIndex);
     }
 
+    // To be called from the timer's ISR handler only. No more interrupt until resumeAlarm()
+    void IRAM_ATTR pauseAlarmFromISR()
+    {
+      setAlarmFromISR(TIMER_IDLE_ALARM_VALUE);
+    }
+    
+    // To be called from the timer's ISR handler only, to re-arm the timer dynamically.
+    // The next interrupt comes ticks ( getDivider() / TIMER_BASE_CLK s ) after the current one. 
+    // Writes the alarm registers directly, without the locking and overhead of the driver
+    void IRAM_ATTR setAlarmFromISR(const uint64_t& ticks)
+    {
+      timer_ll_set_alarm_value(TIMER_LL_GET_HW(_timerGroup), _timerIndex, ticks);
+    }
+    
+    // To be called from the timer's ISR handler only. The counter restarts from 0 at each alarm, so it's the number of
+    // timer ticks since the alarm, i.e. the interrupt entry latency if read first thing in the ISR
+    uint32_t IRAM_ATTR getAlarmLatencyFromISR()
+    {
+      uint64_t ticks;
+      
+      timer_ll_get_counter_value(TIMER_LL_GET_HW(_timerGroup), _timerIndex, &ticks);
+      
+      return (uint32_t) ticks;
+    }
+
+    // From ISR, or with interrupts disabled. The ticks since the start of the timer, if attachInterruptFreeRunning()
+    uint64_t IRAM_ATTR getCounterFromISR()
+    {
+      uint64_t ticks;
+      
+      timer_ll_get_counter_value(TIMER_LL_GET_HW(_timerGroup), _timerIndex, &ticks);
+      
+      return ticks;
+    }
+
+    // Restart the interval from now, next interrupt one interval later. Not to be called from ISR
+    void resumeAlarm()
+    {
+      timer_set_counter_value(_timerGroup, _timerIndex , 0x00000000ULL);
+      timer_set_alarm_value(_timerGroup, _timerIndex, _timerCount);
+    }
+    
+    // Same as resumeAlarm(), from any ISR. Writes the counter and alarm registers directly
+    void IRAM_ATTR resumeAlarmFromISR()
+    {
+      timer_ll_set_counter_value(TIMER_LL_GET_HW(_timerGroup), _timerIndex, 0x00000000ULL);
+      timer_ll_set_alarm_value(TIMER_LL_GET_HW(_timerGroup), _timerIndex, _timerCount);
+    }
+
+#if defined(TIMER_ISR_LATENCY_HOOK)
+
+    // Registered instead of the callback, to measure the latency before anything else
+    static bool IRAM_ATTR latencyISR(void * timer)
+    {
+      TIMER_ISR_LATENCY_HOOK( ( (ESP32TimerInterrupt *) timer)->getAlarmLatencyFromISR() );
+      
+      return ( (ESP32TimerInterrupt *) timer)->_callback( (void *) (uint32_t) ( (ESP32TimerInterrupt *) timer)->_timerNo );
+    }
+    
+#endif
+
+    // Divider in use, the timer counting at TIMER_BASE_CLK / divider
+    uint32_t getDivider()
+    {
+      return stdConfig.divider;
+    }
+    
+    // Interval in use, in ticks
+    uint64_t getTicks()
+    {
+      return _timerCount;
+    }
+
     int8_t getTimer() __attribute__((always_inline))
     {
       return _timerIndex;
@@ -419,6 +632,8 @@ class ESP32TimerInterrupt
 }; // class ESP32TimerInterrupt
 
 #include "ESP32_PWM_ISR.hpp"
+#include "ESP32_BAM_PWM.hpp"
+#include "ESP32_TimerMux.hpp"
 
 #endif    // ESP32_PWM_HPP
 
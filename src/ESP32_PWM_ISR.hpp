@@ -108,6 +108,275 @@ typedef void (*timer_callback_p)(void *);
   #define CHANGING_PWM_END_OF_CYCLE     true
 #endif
 
+#if USING_MICROS_RESOLUTION
+  #define PWM_TIME_UNITS_PER_SECOND     1000000.0
+#else
+  #define PWM_TIME_UNITS_PER_SECOND     1000.0
+#endif
+
+// Fractional part of periods and onTimes, for the DDS-style phase accumulators
+#define PWM_FRACTION_SCALE            4294967296.0      // 2^32
+
+#include <soc/gpio_reg.h>
+
+#include "PWM_Brightness.h"
+
+// Bit n of the mask is GPIOn. Pins 32-39 (ESP32, ESP32_S2, ESP32_S3) are in the upper word
+typedef uint64_t    PWM_GPIO_Mask_t;
+
+#define PWM_GPIO_MASK(pin)        ( ( (pin) < 64 ) ? ( (PWM_GPIO_Mask_t) 1 << (pin) ) : 0 )
+
+// Write many pins with at most 4 register stores, without the per-pin overhead of digitalWrite()
+// Pins in clearMask are driven LOW before pins in setMask are driven HIGH
+inline void IRAM_ATTR PWM_writeGPIOMask(const PWM_GPIO_Mask_t& setMask, const PWM_GPIO_Mask_t& clearMask)
+{
+  if ( (uint32_t) clearMask )
+    REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t) clearMask);
+
+#if defined(GPIO_OUT1_W1TC_REG)
+  if ( (uint32_t) (clearMask >> 32) )
+    REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t) (clearMask >> 32));
+#endif
+
+  if ( (uint32_t) setMask )
+    REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t) setMask);
+
+#if defined(GPIO_OUT1_W1TS_REG)
+  if ( (uint32_t) (setMask >> 32) )
+    REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t) (setMask >> 32));
+#endif
+}
+
+// Deferred channel state transitions, applied by run() only while the pin is LOW, so that no pulse is cut short
+#define PWM_OP_NONE                   0
+#define PWM_OP_DISABLE                1
+#define PWM_OP_DELETE                 2
+
+// Precision classes. Fine channels use the USING_MICROS_RESOLUTION timebase and are serviced by each run().
+// Coarse channels use a ms timebase, and are serviced once every PWM_COARSE_PRESCALER run(), each in its own slot,
+// so that slow channels, e.g. relays, don't cost any work on the other run()
+#define PWM_PRECISION_FINE            0
+#define PWM_PRECISION_COARSE          1
+
+#if !defined(PWM_COARSE_PRESCALER)
+  // 1ms with the usual 20us HW_TIMER_INTERVAL_US
+  #define PWM_COARSE_PRESCALER        50
+#endif
+
+#if (PWM_COARSE_PRESCALER < 1) || (PWM_COARSE_PRESCALER > 255)
+  #error PWM_COARSE_PRESCALER must be 1-255
+#endif
+
+// Max frequency of coarse channels, whose timebase is 1ms
+#define PWM_COARSE_MAX_FREQUENCY      50.0
+
+// What run() does when late by more than the LOW part of a cycle, e.g. during flash writes or Wi-Fi interrupts.
+// The missed edges are counted in all cases, see getOverruns()
+#define PWM_OVERRUN_SKIP              0     // Restart the cycle when noticed. The pulse of the late cycle may be lost
+#define PWM_OVERRUN_COMPRESS          1     // Keep the phase, the next cycle being shortened by the lateness
+#define PWM_OVERRUN_MIN_PULSE         2     // Same as skip, but a lost pulse is emitted, as short as possible
+
+#if !defined(PWM_OVERRUN_POLICY)
+  #define PWM_OVERRUN_POLICY          PWM_OVERRUN_SKIP
+#endif
+
+// isOverloaded() once a run() has taken more than this percentage of the time since the previous run()
+#if !defined(PWM_OVERLOAD_PERCENT)
+  #define PWM_OVERLOAD_PERCENT        50
+#endif
+
+#include <hal/cpu_hal.h>
+
+// Channel events, for waitForEvent(). Can be ORed
+#define PWM_EVENT_PULSE_START         0x01  // output goes HIGH
+#define PWM_EVENT_PULSE_END           0x02  // output goes LOW, e.g. to sample an ADC while the load is off
+#define PWM_EVENT_CYCLE_END           0x04  // end of the period
+#define PWM_EVENT_RAMP_DONE           0x08  // last step of the ramp done, see setRamp(). Reported before PWM_EVENT_STOPPED
+#define PWM_EVENT_STOPPED             0x80  // channel disabled or deleted, always reported
+
+// Two-stage run(). Each run() first emits, in one masked write, the edges computed by the previous run(), then 
+// computes the edges due at the next run(), one tick ahead. The delay of the edges from the interrupt is then the same
+// for all channels, whatever their index and the number of channels, at the cost of a pipeline of one tick : 
+// the callbacks are called, and the pin states reported, when computed
+#if !defined(PWM_PIPELINED_ISR)
+  #define PWM_PIPELINED_ISR           false
+#endif
+
+// Sub-tick look-ahead of the channels set by setHighPrecision(). When the next edge of such a channel is due within 
+// PWM_LOOKAHEAD_US after a run(), run() waits for it, spinning on the CPU cycle counter, instead of leaving it to the 
+// next run(). The edges are then late by at most ( tick - PWM_LOOKAHEAD_US ), for up to PWM_LOOKAHEAD_US more ISR time. 
+// Must be shorter than the tick. Only with USING_MICROS_RESOLUTION, and not with PWM_PIPELINED_ISR
+#if !defined(PWM_LOOKAHEAD_US)
+  #define PWM_LOOKAHEAD_US            5
+#endif
+
+#define PWM_LOOKAHEAD_AVAILABLE       ( USING_MICROS_RESOLUTION && !PWM_PIPELINED_ISR )
+
+// Servo channels, created by setServo(). The servos are shared out between PWM_SERVO_LANES lanes. In each frame of 
+// PWM_SERVO_FRAME_US, the pulses of the servos of a lane are emitted back-to-back, the end of a pulse being the start 
+// of the next one, so that each lane has only one edge pending at a time. A lane takes servos as long as the sum of 
+// their max pulse widths fits in the frame, e.g. 8 servos of 500 - 2500us, or 10 of 1000 - 2000us, at 50Hz
+#if !defined(PWM_SERVO_FRAME_US)
+  #define PWM_SERVO_FRAME_US          20000
+#endif
+
+#if !defined(PWM_SERVO_LANES)
+  #define PWM_SERVO_LANES             2
+#endif
+
+// With a timer attached by attachTimer(), run() moves the next interrupt onto the next servo edge due before the next 
+// tick, so that the widths are exact instead of a whole number of ticks. The interval of the timer restarts from 
+// there. Not with PWM_PIPELINED_ISR, whose edges are written one tick after being computed
+#define PWM_SERVO_ALARM_AVAILABLE     ( USING_MICROS_RESOLUTION && !PWM_PIPELINED_ISR )
+
+// Shortest delay from run() to the interrupt of a servo edge, covering the end of run(). An edge due sooner comes 
+// up to that much late
+#if !defined(PWM_SERVO_MIN_ALARM_US)
+  #define PWM_SERVO_MIN_ALARM_US      2
+#endif
+
+#if (PWM_SERVO_LANES < 1) || (PWM_SERVO_LANES > 16)
+  #error PWM_SERVO_LANES must be 1-16
+#endif
+
+// Max cruise frequency of setRamp(). As for the other channels, the edges are serviced by run(), so that 
+// the steps of several kHz need a short tick, or setHighPrecision()
+#if !defined(PWM_RAMP_MAX_FREQUENCY)
+  #define PWM_RAMP_MAX_FREQUENCY      10000.0
+#endif
+
+// Default pulse width and limits of setServo(), in us
+#define PWM_SERVO_MIN_US              1000
+#define PWM_SERVO_CENTER_US           1500
+#define PWM_SERVO_MAX_US              2000
+
+// Pins covered by the pin-to-channel lookup table
+#define PWM_MAX_PINS                  64
+
+// Generation-tagged channel handle : ( generation << 8 ) | channelNum. 
+// The generation of a slot changes each time the slot is freed, so a handle to a deleted channel is rejected
+typedef int32_t   PWM_Handle_t;
+
+#define PWM_INVALID_HANDLE            ( (PWM_Handle_t) -1 )
+
+// Copy of the live state of a channel, returned by getChannelState()
+typedef struct
+{
+  uint32_t      pin;                // PWM pin, INVALID_ESP32_PIN if the slot is free
+  uint32_t      pinB;               // complementary output, if complementary
+  bool          enabled;
+  bool          pinHigh;            // level of the pin
+  bool          pinBHigh;           // level of pinB
+  bool          exactFreq;          // created by setPWM_Exact()
+  bool          dithered;           // created by setPWM_Dithered()
+  bool          complementary;      // created by setPWM_Complementary()
+  uint8_t       precision;          // PWM_PRECISION_xyz. All times of coarse channels are in ms
+  uint8_t       stopLevel;
+  uint32_t      pendingOp;          // PWM_OP_xyz, waiting for the end of the current pulse
+  uint32_t      period;             // period of the current cycle, in us / ms
+  uint32_t      onTime;             // onTime of the current cycle, in us / ms
+  uint32_t      phase;              // time elapsed in the current cycle, in us / ms
+  uint32_t      newPeriod;          // period waiting for the end of the current cycle, 0 if none
+  uint32_t      newOnTime;
+  float         newDutyCycle;
+  uint32_t      deadTime;
+  uint32_t      overruns;           // number of cycles with missed edges
+  bool          highPrecision;      // set by setHighPrecision()
+  bool          servo;              // created by setServo(). onTime is the pulse width, period the frame
+  bool          oneShot;            // created by firePulseFromISR()
+} PWM_ChannelState_t;
+
+// Binary snapshot of the channels, see saveSnapshot(). In the native byte order, e.g. for NVS or RTC memory
+#define PWM_SNAPSHOT_MAGIC            0x534D5750UL      // "PWMS"
+#define PWM_SNAPSHOT_VERSION          1
+
+// PWM_SnapshotChannel_t.flags
+#define PWM_SNAPSHOT_EXACT            0x01
+#define PWM_SNAPSHOT_DITHERED         0x02
+#define PWM_SNAPSHOT_COMPLEMENTARY    0x04
+#define PWM_SNAPSHOT_COARSE           0x08
+#define PWM_SNAPSHOT_HIGH_PRECISION   0x10
+#define PWM_SNAPSHOT_STOP_HIGH        0x20
+
+typedef struct
+{
+  uint32_t      magic;              // PWM_SNAPSHOT_MAGIC
+  uint16_t      version;            // PWM_SNAPSHOT_VERSION
+  uint8_t       count;              // number of PWM_SnapshotChannel_t following
+  uint8_t       microsResolution;   // USING_MICROS_RESOLUTION, as all times are in us / ms
+  uint32_t      enableMask;         // bit n is set if channel n is enabled
+  uint32_t      checksum;           // FNV-1a of the snapshot by 32-bit words, with checksum = 0
+} PWM_SnapshotHeader_t;
+
+typedef struct
+{
+  uint8_t       channelNum;
+  uint8_t       pin;
+  uint8_t       pinB;               // complementary output
+  uint8_t       flags;              // PWM_SNAPSHOT_xyz
+  uint32_t      period;             // integer part of the period, in us / ms. All times of coarse channels are in ms
+  uint32_t      onTime;             // integer part of the onTime
+  uint32_t      periodFrac;         // fractional part of the period, in 1 / 2^32 us / ms
+  uint32_t      onTimeFrac;         // fractional part of the onTime
+  uint32_t      phase;              // time elapsed in the cycle when saved
+  uint32_t      deadTime;
+} PWM_SnapshotChannel_t;
+
+// Size of a snapshot of count channels. PWM_SNAPSHOT_SIZE(MAX_NUMBER_CHANNELS) is always enough
+#define PWM_SNAPSHOT_SIZE(count)      ( sizeof(PWM_SnapshotHeader_t) + (count) * sizeof(PWM_SnapshotChannel_t) )
+
+// Channel of a table known at compile time, see PWM_STATIC_TABLE(). Computed by PWM_staticChannel()
+typedef struct
+{
+  uint8_t         pin;
+  bool            valid;            // pin, frequency and dutycycle in range
+  uint32_t        period;           // in us / ms
+  uint32_t        onTime;           // in us / ms
+  PWM_GPIO_Mask_t pinMask;
+} PWM_StaticChannel_t;
+
+// Same range checks and float maths as setPWM(), evaluated by the compiler
+constexpr bool PWM_staticChannelValid(const uint32_t pin, const float frequency, const float dutycycle)
+{
+  return (pin < PWM_MAX_PINS) && (frequency > 0.0f) && (frequency <= 500.0f) && (dutycycle >= 0.0f) && 
+         (dutycycle <= 100.0f);
+}
+
+constexpr uint32_t PWM_staticPeriod(const float frequency)
+{
+#if USING_MICROS_RESOLUTION
+  // period in us
+  return (uint32_t) (1000000.0f / frequency);
+#else
+  // period in ms
+  return (uint32_t) (1000.0f / frequency);
+#endif
+}
+
+constexpr PWM_StaticChannel_t PWM_staticChannel(const uint32_t pin, const float frequency, const float dutycycle)
+{
+  return PWM_staticChannelValid(pin, frequency, dutycycle) ? 
+         PWM_StaticChannel_t { (uint8_t) pin, true, PWM_staticPeriod(frequency), 
+                               (uint32_t) ( ( PWM_staticPeriod(frequency) * dutycycle ) / 100 ), PWM_GPIO_MASK(pin) } :
+         PWM_StaticChannel_t { (uint8_t) pin, false, 0, 0, 0 };
+}
+
+template <size_t N>
+constexpr bool PWM_staticTableValid(const PWM_StaticChannel_t (&table)[N], const size_t i = 0)
+{
+  return (i >= N) || ( table[i].valid && (table[i].period != 0) && PWM_staticTableValid(table, i + 1) );
+}
+
+// Declare a constexpr table of channels, rejected at compile time if a pin, frequency or dutycycle is invalid, e.g.
+//   PWM_STATIC_TABLE(PWM_Table, PWM_staticChannel(2, 100.0f, 30.0f), PWM_staticChannel(4, 1.0f, 50.0f));
+//   ISR_PWM.loadStaticTable(PWM_Table);
+#define PWM_STATIC_TABLE(name, ...)                                                                             \
+  constexpr PWM_StaticChannel_t name[] = { __VA_ARGS__ };                                                       \
+  static_assert(PWM_staticTableValid(name), "Invalid pin, frequency or dutycycle in " #name ", max frequency is 500Hz"); \
+  static_assert(sizeof(name) / sizeof(name[0]) <= MAX_NUMBER_CHANNELS, "Too many channels in " #name)
+
+class ESP32TimerInterrupt;
+
 class ESP32_PWM_ISR 
 {
 
@@ -122,6 +391,18 @@ class ESP32_PWM_ISR
 
     // this function must be called inside loop()
     void IRAM_ATTR run();
+
+    // Let the engine pause the interrupts of timer, whose ISR handler calls run(), while no channel needs run(),
+    // i.e. all channels are disabled or deleted, or have a steady 0% / 100% dutycycle.
+    // The interrupts are resumed, from the instant of the change, as soon as a channel is created, enabled or modified.
+    // nullptr to detach, and to keep the interrupts always on as before
+    void attachTimer(ESP32TimerInterrupt* timer);
+    
+    // true if the interrupts of the attached timer are paused
+    bool isTimerIdle()
+    {
+      return timerIdle;
+    }
     
     //////////////////////////////////////////////////////////////////
     // PWM
@@ -151,6 +432,82 @@ class ESP32_PWM_ISR
       return setupPWMChannel(pin, period, dutycycle, (void *) StartCallback, (void *) StopCallback);  
     }
 
+    // Same as setPWM(), but the onTime alternates between its two adjacent ticks, first-order sigma-delta style : 
+    // the fractional part of the onTime, truncated by setPWM(), is carried from cycle to cycle by a phase accumulator.
+    // The pulse lasts exactly onTime, starting in the run() ending the previous cycle, so the long-run average dutycycle
+    // of the pin is exact to better than 16 bits, e.g. 50Hz 0.5% in millis mode is a 1ms pulse one cycle in ten, where
+    // a setPWM() channel gets a 1ms pulse every cycle. The period is still truncated. The modifyXYZ() functions keep
+    // the dithering
+    // Return the channelNum if OK, -1 if error
+    int setPWM_Dithered(const uint32_t& pin, const float& frequency, const float& dutycycle, timer_callback StartCallback = nullptr, 
+                        timer_callback StopCallback = nullptr)
+    {
+      uint32_t period = 0;
+      
+      if ( ( frequency > 0.0 ) && ( frequency <= 500.0 ) )
+      {
+#if USING_MICROS_RESOLUTION
+      // period in us
+      period = 1000000.0f / frequency;
+#else    
+      // period in ms
+      period = 1000.0f / frequency;
+#endif
+      }
+      else
+      {       
+        PWM_LOGERROR("Error: Invalid frequency, max is 500Hz");
+        
+        return -1;
+      }
+      
+      return setupPWMChannel(pin, period, dutycycle, (void *) StartCallback, (void *) StopCallback, 
+                             false, 0, PWM_PRECISION_FINE, true);
+    }
+
+    // Same as setPWM(), but the fractional part of the period, truncated by setPWM(), is carried from cycle to cycle
+    // by a phase accumulator, and each cycle starts exactly one period after the previous one, not when the ISR notices.
+    // The long-run average frequency and dutycycle are then exact, e.g. 3Hz is 333333.33us, not 333333us
+    // Return the channelNum if OK, -1 if error
+    int setPWM_Exact(const uint32_t& pin, const float& frequency, const float& dutycycle, timer_callback StartCallback = nullptr, 
+                     timer_callback StopCallback = nullptr)
+    {
+      uint64_t period = 0;
+      
+      if ( ( frequency > 0.0 ) && ( frequency <= 500.0 ) )
+      {
+        // period in us / ms, 32.32 fixed point
+        period = ( PWM_TIME_UNITS_PER_SECOND * PWM_FRACTION_SCALE ) / frequency;
+      }
+      else
+      {       
+        PWM_LOGERROR("Error: Invalid frequency, max is 500Hz");
+        
+        return -1;
+      }
+      
+      return setupPWMChannel(pin, (uint32_t) (period >> 32), dutycycle, (void *) StartCallback, (void *) StopCallback, 
+                             true, (uint32_t) period);
+    }
+
+    // Same as setPWM(), for slow channels up to PWM_COARSE_MAX_FREQUENCY, such as relays or heaters.
+    // The channel is in the coarse precision class : ms timebase, serviced once every PWM_COARSE_PRESCALER run()
+    // Return the channelNum if OK, -1 if error
+    int setPWM_Coarse(const uint32_t& pin, const float& frequency, const float& dutycycle, timer_callback StartCallback = nullptr, 
+                      timer_callback StopCallback = nullptr)
+    {
+      if ( ( frequency <= 0.0 ) || ( frequency > PWM_COARSE_MAX_FREQUENCY ) )
+      {       
+        PWM_LOGERROR("Error: Invalid frequency, max is 50Hz for coarse channels");
+        
+        return -1;
+      }
+      
+      // period in ms
+      return setupPWMChannel(pin, 1000.0f / frequency, dutycycle, (void *) StartCallback, (void *) StopCallback, 
+                             false, 0, PWM_PRECISION_COARSE);
+    }
+
     // period in us
     // Return the channelNum if OK, -1 if error
     int setPWM_Period(const uint32_t& pin, const uint32_t& period, const float& dutycycle, 
@@ -163,12 +520,33 @@ class ESP32_PWM_ISR
     
     // low level function to modify a PWM channel
     // returns the true on success or false on failure
+    // Channels created by setPWM_Exact() keep their exact frequency
     bool modifyPWMChannel(const uint8_t& channelNum, const uint32_t& pin, const float& frequency, const float& dutycycle)
     {
       uint32_t period = 0;
       
+      if ( (channelNum < MAX_NUMBER_CHANNELS) && (PWM[channelNum].precision == PWM_PRECISION_COARSE) )
+      {
+        if ( ( frequency <= 0.0 ) || ( frequency > PWM_COARSE_MAX_FREQUENCY ) )
+        {
+          PWM_LOGERROR("Error: Invalid frequency, max is 50Hz for coarse channels");
+          return false;
+        }
+        
+        // period in ms
+        return modifyPWMChannel_Period(channelNum, pin, 1000.0f / frequency, dutycycle);
+      }
+      
       if ( ( frequency > 0.0 ) && ( frequency <= 500.0 ) )
       {
+        if ( (channelNum < MAX_NUMBER_CHANNELS) && PWM[channelNum].exactFreq )
+        {
+          // period in us / ms, 32.32 fixed point
+          uint64_t exactPeriod = ( PWM_TIME_UNITS_PER_SECOND * PWM_FRACTION_SCALE ) / frequency;
+          
+          return modifyPWMChannel_Period(channelNum, pin, (uint32_t) (exactPeriod >> 32), dutycycle, (uint32_t) exactPeriod);
+        }
+        
 #if USING_MICROS_RESOLUTION
       // period in us
       period = 1000000.0f / frequency;
@@ -186,10 +564,141 @@ class ESP32_PWM_ISR
       return modifyPWMChannel_Period(channelNum, pin, period, dutycycle);
     }
     
-    //period in us
-    bool modifyPWMChannel_Period(const uint8_t& channelNum, const uint32_t& pin, const uint32_t& period, const float& dutycycle);
+    //period in us, or in ms for coarse channels
+    bool modifyPWMChannel_Period(const uint8_t& channelNum, const uint32_t& pin, const uint32_t& period, const float& dutycycle)
+    {
+      return modifyPWMChannel_Period(channelNum, pin, period, dutycycle, 0);
+    }
+    
+    // Complementary pair for half-bridge drivers, both outputs derived from the same timebase :
+    // pinA is HIGH from 0 to onTime, pinB from ( onTime + deadTime ) to ( period - deadTime ). deadTime in us / ms.
+    // Both pins are written in the same masked GPIO update, and are never HIGH together. Pins must be < 64
+    // As edges are serviced by the ISR, the actual deadTime is rounded up to the ISR tick, and is at least one tick
+    // Return the channelNum if OK, -1 if error
+    int setPWM_Complementary(const uint32_t& pinA, const uint32_t& pinB, const float& frequency, const float& dutycycle,
+                             const uint32_t& deadTime);
+
+    // Create count channels at once, with frequencies in Hz and dutycycles from 0.00 to 100.00.
+    // All pins are initialised in one pass, and all channels share the same start instant.
+    // Either all or none of the channels are created. The channelNums are returned in channelNums[], if not nullptr
+    // Return count if OK, -1 if error
+    int setPWMBatch(const uint32_t* pins, const float* frequencies, const float* dutycycles, const uint8_t& count,
+                    int* channelNums = nullptr);
+                    
+    // Change the dutycycles of count channels, in one critical section. The periods are unchanged.
+    // With CHANGING_PWM_END_OF_CYCLE, each new dutycycle is applied at the end of the current cycle of its channel
+    // returns true on success or false on failure, nothing being changed
+    bool modifyDutyBatch(const uint8_t* channelNums, const float* dutycycles, const uint8_t& count);
+    
+    // Change the dutycycle of the channel, as a fraction of the period from 0 to PWM_MAX_DUTY_FRACTION (100%), 
+    // in integer maths. The period is unchanged, as in modifyDutyBatch()
+    bool modifyDutyFraction(const uint8_t& channelNum, const uint16_t& dutyFraction);
+    
+    // Change the dutycycle of the channel to a perceptual brightness, from 0 to PWM_MAX_BRIGHTNESS, 
+    // converted by a single read of the PWM_BRIGHTNESS_CURVE table
+    bool modifyBrightness(const uint8_t& channelNum, const uint16_t& brightness)
+    {
+      if (brightness > PWM_MAX_BRIGHTNESS)
+      {
+        PWM_LOGERROR("Error: Invalid brightness");
+        return false;
+      }
+      
+      return modifyDutyFraction(channelNum, PWM_Brightness::value[brightness]);
+    }
+
+    // One-shot pulse : pin goes HIGH delay after this call, for width, then the channel is freed by run(). 
+    // Times in us / ms. Callable from any ISR, e.g. a GPIO interrupt : claims a free slot with a few stores under 
+    // PWM_Mux, without logging. The pin must be already set as an OUTPUT, LOW. The edges are serviced by run(), 
+    // with the sub-tick look-ahead of setHighPrecision() if available, see PWM_LOOKAHEAD_US. disable(), disableAll() or 
+    // deleteChannel() cancel a pending pulse and free the slot. enable() can't re-arm it. 
+    // Return the channelNum if OK, -1 if no free slot or invalid width, or before the first channel is created
+    int IRAM_ATTR firePulseFromISR(const uint32_t& pin, const uint32_t& delay, const uint32_t& width);
+    
+    // Trapezoidal frequency ramp for step / direction motor drivers, one step per cycle : from rest, accelerate at accel 
+    // Hz/s up to cruiseFreq Hz, cruise, then decelerate at decel Hz/s, to stop after exactly steps cycles, keeping the 
+    // dutycycle of the channel. The period of each step is computed by run() in integer maths, without the task. 
+    // Once the cycle of the last step is over, the channel is disabled, raising PWM_EVENT_RAMP_DONE, see waitForEvent().
+    // A disabled channel starts at once, an enabled one at the end of its current cycle. The ramp owns the period 
+    // of the channel until done, and is aborted by disable() or deleteChannel(). Only with USING_MICROS_RESOLUTION
+    bool setRamp(const uint8_t& channelNum, const float& cruiseFreq, const float& accel, const float& decel, 
+                 const uint32_t& steps);
+                 
+    // true from setRamp() until the channel is stopped
+    bool isRamping(const uint8_t& channelNum)
+    {
+      return (channelNum < MAX_NUMBER_CHANNELS) && PWM[channelNum].ramping;
+    }
+    
+    // Servo channel, pulseUs wide pulses every PWM_SERVO_FRAME_US, see PWM_SERVO_LANES. All widths in us.
+    // The pulse width is limited to minUs - maxUs. Only with USING_MICROS_RESOLUTION.
+    // The edges are exact to the us with a timer attached by attachTimer(), see PWM_SERVO_ALARM_AVAILABLE. Else, or 
+    // with PWM_PIPELINED_ISR, they are noticed by the next run(), and the widths are a whole number of ticks, e.g. 
+    // 1500us +/- 20us at a 20us interval
+    // Servo channels are changed by the setServoXYZ() functions only, not by modifyPWMChannel() etc.
+    // Return the channelNum if OK, -1 if error, such as no lane with room for maxUs
+    int setServo(const uint32_t& pin, const uint16_t& pulseUs = PWM_SERVO_CENTER_US, const uint16_t& minUs = PWM_SERVO_MIN_US,
+                 const uint16_t& maxUs = PWM_SERVO_MAX_US);
+    
+    // Change the pulse width of the servo, in us, applied from its next pulse. Clamped to the limits of the servo
+    bool setServoPulse(const uint8_t& channelNum, const uint16_t& pulseUs);
+    
+    // Calibration : trimUs is added to each pulse width set by setServoPulse(), before limiting
+    bool setServoTrim(const uint8_t& channelNum, const int16_t& trimUs);
+    
+    // Change the limits of the pulse width of the servo, in us. returns false if the lane has no room for maxUs
+    bool setServoLimits(const uint8_t& channelNum, const uint16_t& minUs, const uint16_t& maxUs);
+
+    // Same as modifyPWMChannel(), the channel being found from its pin in O(1)
+    bool modifyPWMChannelByPin(const uint32_t& pin, const float& frequency, const float& dutycycle)
+    {
+      int channelNum = getChannelByPin(pin);
+      
+      if (channelNum < 0)
+      {
+        PWM_LOGERROR("Error: No channel on this pin");
+        return false;
+      }
+      
+      return modifyPWMChannel(channelNum, pin, frequency, dutycycle);
+    }
+    
+    // Return the channelNum of the latest channel created on the pin, -1 if none
+    int getChannelByPin(const uint32_t& pin)
+    {
+      return ( (pin < PWM_MAX_PINS) && (numChannels > 0) ) ? pinToChannel[pin] : -1;
+    }
+    
+    //////////////////////////////////////////////////////////////////
+    
+    // Return the generation-tagged handle of a channel in use, PWM_INVALID_HANDLE if none
+    PWM_Handle_t getHandle(const uint8_t& channelNum)
+    {
+      if ( (channelNum >= MAX_NUMBER_CHANNELS) || (numChannels <= 0) || (freeMask & (1UL << channelNum)) )
+      {
+        return PWM_INVALID_HANDLE;
+      }
+      
+      return ( (PWM_Handle_t) generation[channelNum] << 8 ) | channelNum;
+    }
+    
+    // Return the channelNum of a handle, -1 if the channel has been deleted since the handle was taken
+    int getChannelFromHandle(const PWM_Handle_t& handle)
+    {
+      uint8_t channelNum = handle & 0xFF;
+      
+      if ( (handle < 0) || (channelNum >= MAX_NUMBER_CHANNELS) || ( (uint8_t) (handle >> 8) != generation[channelNum] ) 
+           || (freeMask & (1UL << channelNum)) )
+      {
+        return -1;
+      }
+      
+      return channelNum;
+    }
 
     // destroy the specified PWM channel
+    // With CHANGING_PWM_END_OF_CYCLE, the channel is freed by run() only at the end of the current pulse,
+    // and the pin is left at the channel's stop level
     void deleteChannel(const uint8_t& channelNum);
 
     // restart the specified PWM channel
@@ -198,12 +707,17 @@ class ESP32_PWM_ISR
     // returns true if the specified PWM channel is enabled
     bool isEnabled(const uint8_t& channelNum);
 
-    // enables the specified PWM channel
+    // enables the specified PWM channel. Not a one-shot pulse, see firePulseFromISR()
     void enable(const uint8_t& channelNum);
 
     // disables the specified PWM channel
+    // With CHANGING_PWM_END_OF_CYCLE, the channel is disabled by run() only at the end of the current pulse,
+    // then the pin is driven to the channel's stop level. isEnabled() stays true until then
     void disable(const uint8_t& channelNum);
 
+    // Output level of the pin once the channel is disabled or deleted. Default is LOW
+    void setStopLevel(const uint8_t& channelNum, const uint8_t& level);
+
     // enables all PWM channels
     void enableAll();
 
@@ -212,9 +726,106 @@ class ESP32_PWM_ISR
 
     // enables the specified PWM channel if it's currently disabled, and vice-versa
     void toggle(const uint8_t& channelNum);
+    
+    // Same as modifyPWMChannel_Period(), modifyDutyFraction(), enable(), disable() and restartChannel(), callable from 
+    // any ISR, e.g. an encoder or comparator interrupt. In IRAM, without float maths or logging, locking PWM_Mux with 
+    // the ISR flavour of the critical section. period in whole us / ms, dutycycle from 0 to PWM_MAX_DUTY_FRACTION.
+    // newDutyCycle is not updated. returns false if channelNum or pin is invalid, or the channel is a servo
+    bool IRAM_ATTR modifyPWMChannel_PeriodFromISR(const uint8_t& channelNum, const uint32_t& pin, const uint32_t& period,
+                                                  const uint16_t& dutyFraction);
+                                                  
+    bool IRAM_ATTR modifyDutyFractionFromISR(const uint8_t& channelNum, const uint16_t& dutyFraction);
+    
+    bool IRAM_ATTR enableFromISR(const uint8_t& channelNum);
+    
+    bool IRAM_ATTR disableFromISR(const uint8_t& channelNum);
+    
+    bool IRAM_ATTR restartChannelFromISR(const uint8_t& channelNum);
 
     // returns the number of used PWM channels
     int8_t getnumChannels();
+    
+    // returns the number of cycles of the channel with missed edges, because run() was late, since its creation.
+    // A cycle is counted if its pulse was lost or not ended in time, plus the whole cycles skipped
+    uint32_t getOverruns(const uint8_t& channelNum)
+    {
+      return (channelNum < MAX_NUMBER_CHANNELS) ? PWM[channelNum].overruns : 0;
+    }
+    
+    // PWM_OVERRUN_xyz, for all channels
+    void setOverrunPolicy(const uint8_t& policy)
+    {
+      overrunPolicy = policy;
+    }
+    
+    // true once a run() has taken more than PWM_OVERLOAD_PERCENT of the time since the previous run(),
+    // e.g. to shed channels before the output quality drops. Stays true until clearOverloaded()
+    bool isOverloaded()
+    {
+      return overloaded;
+    }
+    
+    void clearOverloaded()
+    {
+      overloaded = false;
+    }
+    
+    // Emit the edges of the channel due within PWM_LOOKAHEAD_US after a run() on time, see PWM_LOOKAHEAD_US.
+    // returns false if channelNum is invalid, the channel is coarse, complementary or a servo, or look-ahead is not available
+    bool setHighPrecision(const uint8_t& channelNum, const bool& highPrecision = true);
+    
+    // Longest time spent by a run() waiting for and emitting the look-ahead edges, in ns
+    uint32_t getMaxLookAheadNs()
+    {
+      return cyclesPerUs ? ( (uint64_t) maxLookAheadCycles * 1000 ) / cyclesPerUs : 0;
+    }
+    
+    // Time taken by the last run(), in percentage of the time since the previous run()
+    uint8_t getLoad()
+    {
+      uint32_t tick = tickCycles;
+      uint64_t load = tick ? ( (uint64_t) runCycles * 100 ) / tick : 0;
+      
+      return (load > 100) ? 100 : load;
+    }
+    
+    // Copy the live state of the channel, consistent with the last run(), without blocking run() or the other tasks.
+    // returns false if channelNum is invalid or the slot is free
+    bool getChannelState(const uint8_t& channelNum, PWM_ChannelState_t& state);
+    
+    // Copy the live state of all MAX_NUMBER_CHANNELS slots, all taken at the same instant, free slots with pin 
+    // INVALID_ESP32_PIN. returns the number of used PWM channels
+    int8_t getAllChannelStates(PWM_ChannelState_t states[MAX_NUMBER_CHANNELS]);
+    
+    // Save the configuration of all the channels, with their phases and the enable mask, into a compact versioned 
+    // binary snapshot, e.g. to be stored in NVS or RTC memory. Servo, one-shot and ramping channels, and the 
+    // callbacks, are not saved. A pending change is saved as already applied.
+    // returns the size of the snapshot in bytes, 0 if size is too small
+    size_t saveSnapshot(void* buffer, const size_t& size);
+    
+    // Restore all the channels of a snapshot in one pass, each one in its own slot, all resuming at a common instant 
+    // from their saved phases. The slots must be free, e.g. right after reset. Without callbacks.
+    // returns the number of channels restored, -1 if the snapshot is invalid, from another version or timebase, 
+    // or a slot is used. Either all or none of the channels are restored
+    int restoreSnapshot(const void* buffer, const size_t& size);
+    
+    // Load a table declared by PWM_STATIC_TABLE(), all computed and checked at compile time. Channel n of the table 
+    // is PWM channel n, and all channels start at a common instant, without any float maths or logging per channel.
+    // returns the number of channels loaded, -1 if a slot is used or an entry is invalid, e.g. from a table built 
+    // at run time. Either all or none of the channels are loaded
+    template <size_t N>
+    int loadStaticTable(const PWM_StaticChannel_t (&table)[N])
+    {
+      static_assert(N <= MAX_NUMBER_CHANNELS, "Too many channels in the table");
+      
+      return loadStaticChannels(table, N);
+    }
+    
+    // Block the calling task, without polling, until the next of the events PWM_EVENT_xyz of the enabled channel.
+    // run() wakes it with a single direct-to-task notification, using the notification value of the task.
+    // One waiting task per channel. returns the event, PWM_EVENT_STOPPED if the channel has been stopped, 
+    // or 0 on timeout / error
+    uint8_t waitForEvent(const uint8_t& channelNum, const uint8_t& events, const TickType_t& timeout = portMAX_DELAY);
 
     // returns the number of available PWM channels
     uint8_t getNumAvailablePWMChannels() 
@@ -227,11 +838,279 @@ class ESP32_PWM_ISR
     // low level function to initialize and enable a new PWM channel
     // returns the PWM channel number (channelNum) on success or
     // -1 on failure (f == NULL) or no free PWM channels 
-    int setupPWMChannel(const uint32_t& pin, const uint32_t& period, const float& dutycycle, void* cbStartFunc = nullptr, void* cbStopFunc = nullptr);
+    // exactFreq : keep the phase from cycle to cycle, with periodFrac the fractional part of the period, in 1 / 2^32 us / ms
+    // precision : PWM_PRECISION_xyz. period is in ms for PWM_PRECISION_COARSE
+    // dithered : carry the fractional part of the onTime from cycle to cycle, as exactFreq does
+    int setupPWMChannel(const uint32_t& pin, const uint32_t& period, const float& dutycycle, void* cbStartFunc = nullptr, void* cbStopFunc = nullptr,
+                        const bool& exactFreq = false, const uint32_t& periodFrac = 0, const uint8_t& precision = PWM_PRECISION_FINE,
+                        const bool& dithered = false);
+
+    // Find, claim and fill a free slot, or the free slot given, but don't enable it. Must be called with PWM_Mux held
+    // returns the channelNum, or -1 if no free slot
+    int allocPWMChannel(const uint32_t& pin, const uint32_t& period, const uint32_t& onTime, const bool& exactFreq,
+                        const uint32_t& periodFrac, const uint32_t& onTimeFrac, void* cbStartFunc, void* cbStopFunc,
+                        const uint64_t& startTime, const int8_t& slot = -1);
+                        
+    // Body of loadStaticTable()
+    int loadStaticChannels(const PWM_StaticChannel_t* table, const uint8_t& count);
+    
+    // FNV-1a of the snapshot, by 32-bit words, header.checksum excluded
+    uint32_t snapshotChecksum(const PWM_SnapshotHeader_t& header, const PWM_SnapshotChannel_t* channels);
+
+    // periodFrac is only used by the channels created by setPWM_Exact()
+    bool modifyPWMChannel_Period(const uint8_t& channelNum, const uint32_t& pin, const uint32_t& period, const float& dutycycle,
+                                 const uint32_t& periodFrac);
 
-    // find the first available slot
+    // true if the fractional part of the onTime is carried by onTimeAcc, for channels created by setPWM_Exact() 
+    // or setPWM_Dithered()
+    bool IRAM_ATTR hasOnTimeFrac(const uint8_t& channelNum)
+    {
+      return PWM[channelNum].exactFreq || PWM[channelNum].dithered;
+    }
+
+    // Output A is HIGH while the time elapsed in the cycle is below pulseEnd(). Up to onTime included for the plain 
+    // channels, as always. Not included for the exact and dithered channels, whose average dutycycle is then exact
+    uint32_t IRAM_ATTR pulseEnd(const uint8_t& channelNum)
+    {
+      return PWM[channelNum].onTime + !hasOnTimeFrac(channelNum);
+    }
+
+    // Split ( period + periodFrac / 2^32 ) * dutycycle / 100 into its integer and 1 / 2^32 fractional parts
+    void calculateOnTime(const uint32_t& period, const uint32_t& periodFrac, const float& dutycycle, 
+                         uint32_t& onTime, uint32_t& onTimeFrac)
+    {
+      double exactOnTime = ( ( (double) period + periodFrac / PWM_FRACTION_SCALE ) * dutycycle ) / 100;
+      
+      onTime      = (uint32_t) exactOnTime;
+      onTimeFrac  = (uint32_t) ( (exactOnTime - onTime) * PWM_FRACTION_SCALE );
+    }
+
+    // find the first available slot. Must be called with PWM_Mux held
     int findFirstFreeSlot();
 
+    // Post a deferred state transition, to be applied by run() at the end of the current pulse
+    void requestOp(const uint8_t& channelNum, const uint32_t& op);
+
+    // Called by run() only. Update both outputs of a complementary pair, elapsed being the time in the current cycle
+    void IRAM_ATTR runComplementary(const uint8_t& channelNum, const uint32_t& elapsed);
+
+    // Called by run() only. Emit the edges of the one-shot pulse due, and free the channel once the pulse is over
+    void IRAM_ATTR runOneShot(const uint8_t& channelNum, const uint64_t& channelTime);
+    
+    // Called by run() only. Emit the servo edges due, lane by lane
+    void IRAM_ATTR runServos(const uint64_t& currentTime);
+    
+    // Called by run() only. Set the next interrupt of the attached timer onto the next servo edge, if due before the 
+    // next tick, else back to the interval of the timer
+    void IRAM_ATTR setServoAlarm(const uint64_t& currentTime);
+    
+    // true if channelNum is a servo channel
+    bool isServo(const uint8_t& channelNum)
+    {
+      return (channelNum < MAX_NUMBER_CHANNELS) && (PWM[channelNum].period != 0) && PWM[channelNum].servo;
+    }
+    
+    // Pulse width of the servo, trimmed and limited, in us
+    uint32_t servoOnTime(const uint8_t& channelNum)
+    {
+      int32_t pulse = (int32_t) PWM[channelNum].servoPulse + PWM[channelNum].servoTrim;
+      
+      if (pulse < (int32_t) PWM[channelNum].servoMin)
+        return PWM[channelNum].servoMin;
+        
+      return (pulse > (int32_t) PWM[channelNum].servoMax) ? PWM[channelNum].servoMax : pulse;
+    }
+
+    // Start the next step of the ramp of the channel, and compute the period of the following one. With PWM_Mux held
+    void IRAM_ATTR startRampStep(const uint8_t& channelNum);
+
+    // Called by run() only. End the current cycle of the channel, noticed at channelTime, and start the next one
+    void IRAM_ATTR nextCycle(const uint8_t& channelNum, const uint64_t& channelTime);
+    
+    // Called by run() only. true if the next edge of the channel is due within PWM_LOOKAHEAD_US, in delay
+    bool IRAM_ATTR lookAheadDelay(const uint8_t& channelNum, const uint64_t& currentTime, uint32_t& delay)
+    {
+      if (PWM[channelNum].oneShot)
+      {
+        // Nothing left once the pulse is over. prevTime is the time of the pulse, possibly still ahead
+        if ( PWM[channelNum].pulsed && !PWM[channelNum].pinHigh )
+        {
+          return false;
+        }
+        
+        uint64_t dueTime = PWM[channelNum].prevTime + ( PWM[channelNum].pinHigh ? PWM[channelNum].onTime : 0 );
+        
+        delay = (dueTime > currentTime) ? dueTime - currentTime : 0;
+        
+        return (delay <= PWM_LOOKAHEAD_US);
+      }
+      
+      // No falling edge at 100%, no rising edge at 0%. Pending ops are left to the next run()
+      if ( PWM[channelNum].pendingOp || 
+           ( PWM[channelNum].pinHigh ? ( PWM[channelNum].onTime >= PWM[channelNum].period ) : ( PWM[channelNum].onTime == 0 ) ) )
+      {
+        return false;
+      }
+      
+      uint32_t elapsed = currentTime - PWM[channelNum].prevTime;
+      
+      if (elapsed < pulseEnd(channelNum))
+      {
+        // Falling edge at onTime, or rising edge of a cycle just started by run()
+        delay = PWM[channelNum].pinHigh ? PWM[channelNum].onTime - elapsed : 0;
+      }
+      else
+      {
+        // Rising edge of the next cycle
+        delay = PWM[channelNum].period - elapsed;
+      }
+      
+      return (delay <= PWM_LOOKAHEAD_US);
+    }
+    
+    // Called by run() only. Emit the next edges of the channels, due currentTime + lookAheadDelay(), 
+    // currentTime being read at CPU cycle timeCycles
+    void IRAM_ATTR runLookAhead(uint32_t channels, const uint64_t& currentTime, const uint32_t& timeCycles);
+
+    // Called by run() only. Apply the pending state transition of the channel
+    void IRAM_ATTR applyPendingOp(const uint8_t& channelNum);
+
+    // Stop the channel now, and drive the pin to its stop level. Must be called with PWM_Mux held
+    void IRAM_ATTR stopChannel(const uint8_t& channelNum, const bool& freeChannel);
+
+    // Resume the interrupts of the attached timer, if paused by run(). Called after each change that may need run()
+    void wakeTimer();
+    
+    // Same as wakeTimer(), from any ISR, with PWM_Mux held
+    void IRAM_ATTR wakeTimerFromISR();
+    
+    // Sequence lock of the channel states, for getChannelState(). Odd while PWM[] is being changed, with PWM_Mux held
+    void IRAM_ATTR beginStateWrite()
+    {
+      __atomic_store_n(&stateSeq, stateSeq + 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+    
+    void IRAM_ATTR endStateWrite()
+    {
+      __atomic_store_n(&stateSeq, stateSeq + 1, __ATOMIC_RELEASE);
+    }
+    
+    // Period and periodFrac the new onTime applies to, i.e. the new period if waiting to be applied. With PWM_Mux held
+    void IRAM_ATTR nextPeriod(const uint8_t& channelNum, uint32_t& period, uint32_t& periodFrac);
+    
+    // Change the onTime of the channel, at the end of the current cycle with CHANGING_PWM_END_OF_CYCLE. 
+    // With PWM_Mux held
+    void IRAM_ATTR setOnTime(const uint8_t& channelNum, const uint32_t& period, const uint32_t& periodFrac, 
+                             const uint32_t& onTime, const uint32_t& onTimeFrac);
+                             
+    // Change the period and onTime of the channel, at the end of the current cycle with CHANGING_PWM_END_OF_CYCLE, 
+    // else restarting the cycle now. With PWM_Mux held
+    void IRAM_ATTR setPeriod(const uint8_t& channelNum, const uint32_t& period, const uint32_t& periodFrac, 
+                             const uint32_t& onTime, const uint32_t& onTimeFrac);
+    
+    // Change the onTime of the channel to dutyFraction of its period, in integer maths. With PWM_Mux held
+    void IRAM_ATTR setDutyFraction(const uint8_t& channelNum, const uint16_t& dutyFraction);
+    
+    // Reported by getChannelState(), only while waiting for the end of the cycle. With PWM_Mux held
+    void setNewDutyCycle(const uint8_t& channelNum, const float& dutycycle)
+    {
+#if CHANGING_PWM_END_OF_CYCLE
+      PWM[channelNum].newDutyCycle = dutycycle;
+#else
+      (void) channelNum;
+      (void) dutycycle;
+#endif
+    }
+    
+    // Body of enable(), with PWM_Mux held
+    void IRAM_ATTR startChannel(const uint8_t& channelNum);
+    
+    // Copy the states of count channels from firstChannel, retrying until not changed meanwhile
+    void copyChannelStates(const uint8_t& firstChannel, const uint8_t& count, PWM_ChannelState_t* states);
+
+    // Current time in the timebase of the channel, us / ms for fine channels, ms for coarse channels
+    uint64_t IRAM_ATTR channelTimeNow(const uint8_t& channelNum);
+
+    // A steady 0% / 100% dutycycle, already at its level, has no more edge until changed
+    bool IRAM_ATTR isSteady(const uint8_t& channelNum)
+    {
+      return ( PWM[channelNum].pinHigh ? ( PWM[channelNum].onTime >= PWM[channelNum].period ) : 
+                                         ( PWM[channelNum].onTime == 0 ) ) && 
+             !( PWM[channelNum].pendingOp || PWM[channelNum].newPeriod || PWM[channelNum].complementary || 
+                PWM[channelNum].periodFrac || PWM[channelNum].onTimeFrac || PWM[channelNum].waitEvents || 
+                PWM[channelNum].oneShot );
+    }
+    
+    // Call the callback of the edge of output A, and wake the task waiting for it, if any
+    void IRAM_ATTR pulseEdge(const uint8_t& channelNum, const bool& high)
+    {
+      void* callback = high ? PWM[channelNum].callbackStart : PWM[channelNum].callbackStop;
+      
+      if (callback != nullptr)
+      {
+        (*(timer_callback) callback)();
+      }
+      
+      notifyEvent(channelNum, high ? PWM_EVENT_PULSE_START : PWM_EVENT_PULSE_END);
+    }
+    
+    // Called by run() only. Output A goes HIGH, at the next run() with PWM_PIPELINED_ISR
+    void IRAM_ATTR startPulse(const uint8_t& channelNum)
+    {
+      PWM[channelNum].pinHigh = true;
+      PWM[channelNum].pulsed  = true;
+
+#if PWM_PIPELINED_ISR
+      nextSetMask         |= PWM_GPIO_MASK(PWM[channelNum].pin);
+      nextStartedChannels |= (1UL << channelNum);
+#else
+      digitalWrite(PWM[channelNum].pin, HIGH);
+
+      // callbackStart
+      pulseEdge(channelNum, true);
+#endif
+    }
+    
+    // Drop the edges of the channel computed by run() and not emitted yet, before writing its pins directly
+    void IRAM_ATTR cancelPendingEdges(const uint8_t& channelNum)
+    {
+#if PWM_PIPELINED_ISR
+      PWM_GPIO_Mask_t pinMask = PWM_GPIO_MASK(PWM[channelNum].pin) | 
+                                ( PWM[channelNum].complementary ? PWM_GPIO_MASK(PWM[channelNum].pinB) : 0 );
+      
+      nextSetMask         &= ~pinMask;
+      nextClearMask       &= ~pinMask;
+      nextStartedChannels &= ~(1UL << channelNum);
+      nextStoppedChannels &= ~(1UL << channelNum);
+      nextPulseMask       &= ~pinMask;
+      nextPulsedChannels  &= ~(1UL << channelNum);
+#else
+      (void) channelNum;
+#endif
+    }
+    
+#if PWM_PIPELINED_ISR
+    // No look-ahead over the gap before the next run(), e.g. while the timer was paused
+    void IRAM_ATTR resetLookAhead()
+    {
+      lastRunTime = 0;
+      lastTick    = 0;
+    }
+#endif
+
+    // Wake the task waiting for this event of the channel, if any. The timer ISR returning true yields to it
+    void IRAM_ATTR notifyEvent(const uint8_t& channelNum, const uint8_t& event)
+    {
+      if (PWM[channelNum].waitEvents & event)
+      {
+        xTaskNotifyFromISR((TaskHandle_t) PWM[channelNum].waitTask, event, eSetValueWithOverwrite, nullptr);
+        
+        PWM[channelNum].waitTask    = nullptr;
+        PWM[channelNum].waitEvents  = 0;
+      }
+    }
+
     typedef struct 
     {
       ///////////////////////////////////
@@ -240,8 +1119,8 @@ class ESP32_PWM_ISR
       ///////////////////////////////////
       
       uint64_t      prevTime;           // value returned by the micros() or millis() function in the previous run() call
-      uint32_t      period;             // period value, in us / ms
-      uint32_t      onTime;             // onTime value, ( period * dutyCycle / 100 ) us  / ms
+      uint32_t      period;             // period value of the current cycle, in us / ms
+      uint32_t      onTime;             // onTime value of the current cycle, ( period * dutyCycle / 100 ) us  / ms
       
       void*         callbackStart;      // pointer to the callback function when PWM pulse starts (HIGH)
       void*         callbackStop;       // pointer to the callback function when PWM pulse stops (LOW)
@@ -259,12 +1138,136 @@ class ESP32_PWM_ISR
       uint32_t      newOnTime;          // onTime value, ( period * dutyCycle / 100 ) us  / ms
       float         newDutyCycle;       // from 0.00 to 100.00, float precision
       //////
+      
+      // New from v1.4.0, DDS-style phase accumulators. All fractions are 0 if not exactFreq, except onTimeFrac if dithered
+      bool          exactFreq;          // true if created by setPWM_Exact()
+      bool          dithered;           // true if created by setPWM_Dithered()
+      uint32_t      basePeriod;         // integer part of the period, in us / ms
+      uint32_t      baseOnTime;         // integer part of the onTime, in us / ms
+      uint32_t      periodFrac;         // fractional part of the period, in 1 / 2^32 us / ms
+      uint32_t      onTimeFrac;         // fractional part of the onTime, in 1 / 2^32 us / ms
+      uint32_t      periodAcc;          // phase accumulator of periodFrac. A carry lengthens the cycle by 1 us / ms
+      uint32_t      onTimeAcc;          // phase accumulator of onTimeFrac. A carry lengthens the onTime by 1 us / ms
+      uint32_t      newPeriodFrac;
+      uint32_t      newOnTimeFrac;
+      
+      // Deferred disable / delete request, PWM_OP_xyz. Written by tasks, exchanged to PWM_OP_NONE by run()
+      uint32_t      pendingOp;
+      uint8_t       stopLevel;          // pin level once disabled or deleted
+      
+      // Complementary pair, both outputs from the same prevTime
+      bool          complementary;      // true if created by setPWM_Complementary()
+      bool          pinBHigh;           // true if pinB is HIGH
+      uint32_t      pinB;               // complementary output
+      uint32_t      deadTime;           // both outputs LOW around each edge, in us / ms
+      
+      uint8_t       precision;          // PWM_PRECISION_xyz. All times of coarse channels are in ms
+      
+      // Missed edges
+      bool          pulsed;             // true if the pin has gone HIGH in the current cycle
+      uint32_t      overruns;           // number of cycles with missed edges
+      
+      // waitForEvent()
+      TaskHandle_t  waitTask;           // task waiting for an event, nullptr if none
+      uint8_t       waitEvents;         // PWM_EVENT_xyz waited for, 0 if none
+      
+      bool          highPrecision;      // edges emitted by runLookAhead() if due shortly after run()
+      
+      // Servo channels, serviced by runServos() only. prevTime is the start of the latest pulse
+      bool          servo;              // true if created by setServo()
+      uint8_t       servoLane;
+      uint16_t      servoPulse;         // pulse width set by setServoPulse(), in us
+      int16_t       servoTrim;          // in us
+      uint16_t      servoMin;           // in us
+      uint16_t      servoMax;           // in us
+      
+      // One-shot pulse, see firePulseFromISR(). prevTime is the time of the pulse, onTime its width
+      bool          oneShot;
+      
+      // Trapezoidal ramp, see setRamp(). Periods in 1 / 256 us
+      bool          ramping;            // true until the channel is stopped
+      uint32_t      rampSteps;          // steps not started yet
+      uint32_t      rampDecelSteps;     // number of steps of the deceleration
+      int32_t       rampN;              // index of the next step in the AVR446 recurrence, negative while decelerating
+      int32_t       rampRest;           // remainder of the recurrence, carried to the next step
+      uint32_t      rampPeriod;         // period of the next step
+      uint32_t      rampMinPeriod;      // cruise period
+      uint16_t      rampDuty;           // onTime / period, in 1 / 65536
+      //////
     } PWM_t;
 
     volatile PWM_t PWM[MAX_NUMBER_CHANNELS];
+    
+    typedef struct
+    {
+      uint32_t      mask;               // bit n is set if PWM[n] is a servo of the lane
+      uint32_t      load;               // sum of the servoMax of the lane, in us
+      int8_t        channelNum;         // servo whose pulse ends at nextEdge, -1 if nextEdge is the end of the frame
+      uint64_t      frameStart;         // in us
+      uint64_t      nextEdge;           // in us
+    } PWM_ServoLane_t;
+    
+    volatile PWM_ServoLane_t servoLanes[PWM_SERVO_LANES];
 
     // actual number of PWM channels in use (-1 means uninitialized)
     volatile int8_t numChannels;
+    
+    // bit n is set if PWM[n] is free. Changed only with PWM_Mux held
+    volatile uint32_t freeMask;
+    
+    // generation of each slot, incremented each time the slot is freed. Not cleared by init()
+    volatile uint8_t  generation[MAX_NUMBER_CHANNELS];
+    
+    // channelNum of the latest channel created on each pin, -1 if none
+    volatile int8_t   pinToChannel[PWM_MAX_PINS];
+
+    // Timer paused by run() when idle, nullptr if none
+    ESP32TimerInterrupt*  idleTimer;
+    volatile bool         timerIdle;
+    
+    // Slot of the coarse channels serviced by the current run(), 0 to ( PWM_COARSE_PRESCALER - 1 )
+    uint8_t               coarseSlot;
+    
+    // Incremented before and after each change of PWM[]
+    volatile uint32_t     stateSeq;
+    
+    uint8_t               overrunPolicy;
+    
+    // Engine load, in CPU cycles
+    uint32_t              lastRunStart;
+    volatile uint32_t     runCycles;
+    volatile uint32_t     tickCycles;
+    volatile bool         overloaded;
+    
+    // Look-ahead
+    uint32_t              cyclesPerUs;
+    volatile uint32_t     maxLookAheadCycles;
+    
+#if PWM_SERVO_ALARM_AVAILABLE
+    // Interval and divider of the attached timer, and the alarm set by setServoAlarm() instead, 0 if none
+    uint64_t              timerTicks;
+    uint32_t              timerDivider;
+    uint64_t              servoAlarm;
+#endif
+    
+#if PWM_PIPELINED_ISR
+    // Edges due at the next run(), and the channels whose output A goes HIGH / LOW then
+    PWM_GPIO_Mask_t       nextSetMask;
+    PWM_GPIO_Mask_t       nextClearMask;
+    uint32_t              nextStartedChannels;
+    uint32_t              nextStoppedChannels;
+    
+    // Pulses lost by a late run(), emitted first, as short as possible, see PWM_OVERRUN_MIN_PULSE
+    PWM_GPIO_Mask_t       nextPulseMask;
+    uint32_t              nextPulsedChannels;
+    
+    // Time of the previous run(), 0 if none since the timer was paused, and its distance to the one before, in us / ms
+    uint64_t              lastRunTime;
+    uint32_t              lastTick;
+    
+    // Interval of the timer calling run(), in us / ms
+    uint32_t              maxLookAhead;
+#endif
 
     // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
     portMUX_TYPE PWM_Mux = portMUX_INITIALIZER_UNLOCKED;
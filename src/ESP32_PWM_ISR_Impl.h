@@ -44,6 +44,7 @@
 #define PWM_ISR_GENERIC_IMPL_H
 
 #include <string.h>
+#include <math.h>
 
 ///////////////////////////////////////////////////
 
@@ -57,11 +58,28 @@ uint64_t IRAM_ATTR timeNow()
 #endif
 }
 
+// Timebase of the coarse channels
+uint64_t IRAM_ATTR timeNowCoarse()
+{
+  return ( (uint64_t) millis() );
+}
+
 ///////////////////////////////////////////////////
 
 ESP32_PWM_ISR::ESP32_PWM_ISR()
-  : numChannels (-1)
+  : numChannels (-1), freeMask (0), idleTimer (nullptr), timerIdle (false), coarseSlot (0), stateSeq (0),
+    overrunPolicy (PWM_OVERRUN_POLICY), lastRunStart (0), runCycles (0), tickCycles (0), overloaded (false),
+    cyclesPerUs (0), maxLookAheadCycles (0)
+#if PWM_SERVO_ALARM_AVAILABLE
+    , timerTicks (0), timerDivider (1), servoAlarm (0)
+#endif
+#if PWM_PIPELINED_ISR
+    , nextSetMask (0), nextClearMask (0), nextStartedChannels (0), nextStoppedChannels (0), nextPulseMask (0), 
+    nextPulsedChannels (0), lastRunTime (0), lastTick (0),
+      maxLookAhead (0xFFFFFFFF)
+#endif
 {
+  memset((void*) generation, 0, sizeof (generation));
 }
 
 ///////////////////////////////////////////////////
@@ -77,8 +95,25 @@ void ESP32_PWM_ISR::init()
     PWM[channelNum].pin      = INVALID_ESP32_PIN;
   }
 
+  for (uint8_t pin = 0; pin < PWM_MAX_PINS; pin++)
+  {
+    pinToChannel[pin] = -1;
+  }
+
+  freeMask    = (MAX_NUMBER_CHANNELS < 32) ? ( (1UL << MAX_NUMBER_CHANNELS) - 1 ) : 0xFFFFFFFF;
+
+  memset((void*) servoLanes, 0, sizeof (servoLanes));
+
+  for (uint8_t laneNum = 0; laneNum < PWM_SERVO_LANES; laneNum++)
+  {
+    servoLanes[laneNum].channelNum = -1;
+  }
+
   numChannels = 0;
 
+  // For the look-ahead of the one-shot pulses, fired from ISR
+  cyclesPerUs = getCpuFrequencyMhz();
+
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
   PWM_Mux = portMUX_INITIALIZER_UNLOCKED;
 }
@@ -87,11 +122,99 @@ void ESP32_PWM_ISR::init()
 
 void IRAM_ATTR ESP32_PWM_ISR::run()
 {
+  uint32_t runStart = cpu_hal_get_cycle_count();
+  
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
   portENTER_CRITICAL_ISR(&PWM_Mux);
 
+#if PWM_PIPELINED_ISR
+
+  // Stage 1 : emit the edges computed by the previous run(), before anything else. The lost pulses first, HIGH then 
+  // LOW, as the masked write clears before it sets
+  if (nextPulseMask)
+  {
+    PWM_writeGPIOMask(nextPulseMask, 0);
+    PWM_writeGPIOMask(0, nextPulseMask);
+  }
+
+  PWM_writeGPIOMask(nextSetMask, nextClearMask);
+
+  uint32_t pulsedChannels   = nextPulsedChannels;
+  uint32_t startedChannels  = nextStartedChannels;
+  uint32_t stoppedChannels  = nextStoppedChannels;
+
+  nextSetMask         = 0;
+  nextClearMask       = 0;
+  nextStartedChannels = 0;
+  nextStoppedChannels = 0;
+  nextPulseMask       = 0;
+  nextPulsedChannels  = 0;
+
+#endif
+
+  beginStateWrite();
+
   uint64_t currentTime = timeNow();
 
+#if PWM_LOOKAHEAD_AVAILABLE
+
+  uint32_t timeCycles = cpu_hal_get_cycle_count();
+
+  // Channels with an edge due within PWM_LOOKAHEAD_US
+  uint32_t lookAheadChannels = 0;
+
+#endif
+
+#if PWM_PIPELINED_ISR
+
+  // then their callbacks, in the order of the edges. A channel both stopped and started went LOW, then HIGH again
+  while (pulsedChannels)
+  {
+    pulseEdge(__builtin_ctz(pulsedChannels), true);
+    pulseEdge(__builtin_ctz(pulsedChannels), false);
+    pulsedChannels &= pulsedChannels - 1;
+  }
+
+  while (stoppedChannels)
+  {
+    pulseEdge(__builtin_ctz(stoppedChannels), false);
+    stoppedChannels &= stoppedChannels - 1;
+  }
+
+  while (startedChannels)
+  {
+    pulseEdge(__builtin_ctz(startedChannels), true);
+    startedChannels &= startedChannels - 1;
+  }
+
+  // Stage 2 : compute the edges due at the next run(), expected one tick later : the shorter of the last two run()
+  // intervals, never more than the timer interval. A first run(), or one resuming from idle, has no look-ahead
+  uint32_t tick       = lastRunTime ? (uint32_t) (currentTime - lastRunTime) : 0;
+  uint32_t lookAhead  = (tick < lastTick) ? tick : lastTick;
+
+  // Without an attached timer, its interval is the shortest one seen
+  if ( (idleTimer == nullptr) && tick && (tick < maxLookAhead) )
+  {
+    maxLookAhead = tick;
+  }
+
+  if (lookAhead > maxLookAhead)
+  {
+    lookAhead = maxLookAhead;
+  }
+
+  lastTick    = tick;
+  lastRunTime = currentTime;
+  currentTime += lookAhead;
+
+#endif
+  
+  // Number of channels still needing run()
+  uint8_t activeChannels = 0;
+  
+  // Read once, by the first coarse channel serviced
+  uint64_t coarseTime = 0;
+
   for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_CHANNELS; channelNum++)
   {
     // If enabled => check
@@ -99,367 +222,2778 @@ void IRAM_ATTR ESP32_PWM_ISR::run()
     // end dutyCycle =>  digitalWrite LOW
     if (PWM[channelNum].enabled)
     {
-      if ( (uint32_t) (currentTime - PWM[channelNum].prevTime) <= PWM[channelNum].onTime )
+      uint64_t channelTime = currentTime;
+      
+      // Coarse channels are serviced in their own slot only
+      if (PWM[channelNum].precision == PWM_PRECISION_COARSE)
       {
-        if (!PWM[channelNum].pinHigh)
+        if ( (channelNum % PWM_COARSE_PRESCALER) != coarseSlot )
         {
-          digitalWrite(PWM[channelNum].pin, HIGH);
-          PWM[channelNum].pinHigh = true;
-
-          // callbackStart
-          if (PWM[channelNum].callbackStart != nullptr)
+          // Still need run() later
+          if ( idleTimer && !isSteady(channelNum) )
           {
-            (*(timer_callback) PWM[channelNum].callbackStart)();
+            activeChannels++;
           }
+          
+          continue;
+        }
+        
+        if (coarseTime == 0)
+        {
+          coarseTime = timeNowCoarse();
+        }
+        
+        channelTime = coarseTime;
+      }
+      
+      // Disable / delete only while the pin is LOW, or at the end of the period for a 100% dutycycle.
+      // Never cut a pulse short
+      if ( PWM[channelNum].pendingOp && ( ( !PWM[channelNum].pinHigh && !PWM[channelNum].pinBHigh ) ||
+           ( (uint32_t) (channelTime - PWM[channelNum].prevTime) >= PWM[channelNum].period ) ) )
+      {
+        applyPendingOp(channelNum);
+
+        continue;
+      }
+
+      // Serviced by runServos(), lane by lane
+      if (PWM[channelNum].servo)
+      {
+        activeChannels++;
+
+        continue;
+      }
+
+      if (PWM[channelNum].oneShot)
+      {
+        runOneShot(channelNum, channelTime);
+      }
+      else if ( PWM[channelNum].complementary && 
+                ( (uint32_t) (channelTime - PWM[channelNum].prevTime) < PWM[channelNum].period ) )
+      {
+        runComplementary(channelNum, (uint32_t) (channelTime - PWM[channelNum].prevTime));
+      }
+      else if ( (uint32_t) (channelTime - PWM[channelNum].prevTime) < pulseEnd(channelNum) )
+      {
+        if (!PWM[channelNum].pinHigh)
+        {
+          startPulse(channelNum);
         }
       }
-      else if ( (uint32_t) (currentTime - PWM[channelNum].prevTime) < PWM[channelNum].period )
+      else if ( (uint32_t) (channelTime - PWM[channelNum].prevTime) < PWM[channelNum].period )
       {
         if (PWM[channelNum].pinHigh)
         {
-          digitalWrite(PWM[channelNum].pin, LOW);
           PWM[channelNum].pinHigh = false;
 
+#if PWM_PIPELINED_ISR
+          nextClearMask       |= PWM_GPIO_MASK(PWM[channelNum].pin);
+          nextStoppedChannels |= (1UL << channelNum);
+#else
+          digitalWrite(PWM[channelNum].pin, LOW);
+
           // callback when PWM pulse stops (LOW)
-          if (PWM[channelNum].callbackStop != nullptr)
-          {
-            (*(timer_callback) PWM[channelNum].callbackStop)();
-          }
+          pulseEdge(channelNum, false);
+#endif
         }
       }
       //else
-      else if ( (uint32_t) (currentTime - PWM[channelNum].prevTime) >= PWM[channelNum].period )
+      else if ( (uint32_t) (channelTime - PWM[channelNum].prevTime) >= PWM[channelNum].period )
+      {
+        nextCycle(channelNum, channelTime);
+
+        // The exact and dithered channels start the new pulse in this pass, not one tick later, so that it lasts onTime
+        if ( hasOnTimeFrac(channelNum) && !PWM[channelNum].pinHigh && !PWM[channelNum].pendingOp && 
+             ( (uint32_t) (channelTime - PWM[channelNum].prevTime) < pulseEnd(channelNum) ) )
+        {
+          startPulse(channelNum);
+        }
+      }
+
+#if PWM_LOOKAHEAD_AVAILABLE
+
+      uint32_t delay;
+
+      if ( PWM[channelNum].highPrecision && lookAheadDelay(channelNum, currentTime, delay) )
+      {
+        lookAheadChannels |= (1UL << channelNum);
+      }
+
+#endif
+      
+      if (!isSteady(channelNum))
+      {
+        activeChannels++;
+      }
+    }
+  }
+  
+  runServos(currentTime);
+
+#if PWM_SERVO_ALARM_AVAILABLE
+
+  if (idleTimer)
+  {
+    setServoAlarm(currentTime);
+  }
+
+#endif
+
+#if PWM_LOOKAHEAD_AVAILABLE
+
+  // After all the other channels
+  if (lookAheadChannels)
+  {
+    runLookAhead(lookAheadChannels, currentTime, timeCycles);
+  }
+
+#endif
+  
+  if (++coarseSlot >= PWM_COARSE_PRESCALER)
+  {
+    coarseSlot = 0;
+  }
+  
+#if PWM_PIPELINED_ISR
+
+  // The edges computed by this pass are only written by the next run()
+  if (nextSetMask | nextClearMask | nextStartedChannels | nextStoppedChannels | nextPulseMask)
+  {
+    activeChannels++;
+  }
+
+#endif
+
+  // Nothing to do until a channel is created, enabled or modified. See wakeTimer()
+  if ( (activeChannels == 0) && idleTimer && !timerIdle )
+  {
+    timerIdle = true;
+    idleTimer->pauseAlarmFromISR();
+
+#if PWM_SERVO_ALARM_AVAILABLE
+    // Resumed with the interval of the timer
+    servoAlarm = 0;
+#endif
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&PWM_Mux);
+  
+  // Engine load, the CPU cycle counter wrapping around every 2^32 cycles
+  runCycles     = cpu_hal_get_cycle_count() - runStart;
+  tickCycles    = runStart - lastRunStart;
+  lastRunStart  = runStart;
+  
+  if ( (uint64_t) runCycles * 100 > (uint64_t) tickCycles * PWM_OVERLOAD_PERCENT )
+  {
+    overloaded = true;
+  }
+}
+
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::runComplementary(const uint8_t& channelNum, const uint32_t& elapsed)
+{
+  // Output A : HIGH from 0 to onTime
+  // Output B : HIGH from ( onTime + deadTime ) to ( period - deadTime )
+  bool wantHighA = (elapsed < PWM[channelNum].onTime);
+  bool wantHighB = (elapsed >= PWM[channelNum].onTime + PWM[channelNum].deadTime) && 
+                   (elapsed + PWM[channelNum].deadTime < PWM[channelNum].period);
+
+  // An output only goes HIGH if the other one was already LOW before this run(), so that even with
+  // a deadTime shorter than the ISR tick, both outputs are LOW together during at least one tick
+  bool wasHighA = PWM[channelNum].pinHigh;
+  bool wasHighB = PWM[channelNum].pinBHigh;
+
+  PWM_GPIO_Mask_t setMask   = 0;
+  PWM_GPIO_Mask_t clearMask = 0;
+
+  if (wasHighA && !wantHighA)
+  {
+    clearMask |= PWM_GPIO_MASK(PWM[channelNum].pin);
+    PWM[channelNum].pinHigh = false;
+  }
+
+  if (wasHighB && !wantHighB)
+  {
+    clearMask |= PWM_GPIO_MASK(PWM[channelNum].pinB);
+    PWM[channelNum].pinBHigh = false;
+  }
+
+  if (!wasHighA && wantHighA && !wasHighB)
+  {
+    setMask |= PWM_GPIO_MASK(PWM[channelNum].pin);
+    PWM[channelNum].pinHigh = true;
+    PWM[channelNum].pulsed  = true;
+  }
+
+  if (!wasHighB && wantHighB && !wasHighA)
+  {
+    setMask |= PWM_GPIO_MASK(PWM[channelNum].pinB);
+    PWM[channelNum].pinBHigh = true;
+  }
+
+  if (setMask | clearMask)
+  {
+#if PWM_PIPELINED_ISR
+
+    // Both pins in the masked update of the next run(), LOW first
+    nextSetMask   |= setMask;
+    nextClearMask |= clearMask;
+
+    if (PWM[channelNum].pinHigh != wasHighA)
+    {
+      if (PWM[channelNum].pinHigh)
+        nextStartedChannels |= (1UL << channelNum);
+      else
+        nextStoppedChannels |= (1UL << channelNum);
+    }
+
+#else
+
+    // Both pins in the same masked update, LOW first
+    PWM_writeGPIOMask(setMask, clearMask);
+
+    // callbacks follow output A
+    if (PWM[channelNum].pinHigh != wasHighA)
+    {
+      pulseEdge(channelNum, (bool) PWM[channelNum].pinHigh);
+    }
+
+#endif
+  }
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::runOneShot(const uint8_t& channelNum, const uint64_t& channelTime)
+{
+  if (!PWM[channelNum].pulsed)
+  {
+    if (channelTime >= PWM[channelNum].prevTime)
+    {
+      PWM[channelNum].pinHigh = true;
+      PWM[channelNum].pulsed  = true;
+
+#if PWM_PIPELINED_ISR
+      nextSetMask         |= PWM_GPIO_MASK(PWM[channelNum].pin);
+      nextStartedChannels |= (1UL << channelNum);
+#else
+      digitalWrite(PWM[channelNum].pin, HIGH);
+
+      pulseEdge(channelNum, true);
+#endif
+    }
+  }
+  else if (PWM[channelNum].pinHigh)
+  {
+    if (channelTime - PWM[channelNum].prevTime >= PWM[channelNum].onTime)
+    {
+      PWM[channelNum].pinHigh = false;
+
+#if PWM_PIPELINED_ISR
+      nextClearMask       |= PWM_GPIO_MASK(PWM[channelNum].pin);
+      nextStoppedChannels |= (1UL << channelNum);
+#else
+      digitalWrite(PWM[channelNum].pin, LOW);
+
+      pulseEdge(channelNum, false);
+#endif
+    }
+  }
+  else
+  {
+    // The pulse is over, and emitted even if pipelined
+    stopChannel(channelNum, true);
+  }
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::runServos(const uint64_t& currentTime)
+{
+  for (uint8_t laneNum = 0; laneNum < PWM_SERVO_LANES; laneNum++)
+  {
+    volatile PWM_ServoLane_t& lane = servoLanes[laneNum];
+
+    if ( (lane.mask == 0) || (currentTime < lane.nextEdge) )
+    {
+      continue;
+    }
+
+    // Edges are scheduled from the previous ones, not from when noticed, so that run() jitter doesn't add up.
+    // Resync if late by more than a whole frame
+    uint64_t edgeTime = ( (currentTime - lane.nextEdge) < PWM_SERVO_FRAME_US ) ? lane.nextEdge : currentTime;
+    
+    int8_t   stopped  = lane.channelNum;
+    int8_t   started  = -1;
+    uint32_t servos;
+
+    PWM_GPIO_Mask_t setMask   = 0;
+    PWM_GPIO_Mask_t clearMask = 0;
+
+    if (stopped >= 0)
+    {
+      // End of the pulse. The servo may have been stopped meanwhile, already driven to its stop level
+      if ( PWM[stopped].servo && PWM[stopped].enabled && PWM[stopped].pinHigh )
+      {
+        PWM[stopped].pinHigh  = false;
+        clearMask             = PWM_GPIO_MASK(PWM[stopped].pin);
+      }
+      else
+      {
+        stopped = -1;
+      }
+
+      // The next servos of the frame
+      servos = lane.mask & ~( (2UL << lane.channelNum) - 1 );
+    }
+    else
+    {
+      // End of the frame
+      lane.frameStart = edgeTime;
+      servos          = lane.mask;
+    }
+
+    // The next enabled servo starts right away, back-to-back
+    while (servos)
+    {
+      uint8_t channelNum = __builtin_ctz(servos);
+
+      if ( PWM[channelNum].enabled && !PWM[channelNum].pendingOp )
       {
-        PWM[channelNum].prevTime = currentTime;
+        started = channelNum;
+        break;
+      }
+
+      servos &= servos - 1;
+    }
+
+    if (started >= 0)
+    {
+      notifyEvent(started, PWM_EVENT_CYCLE_END);
+
+      PWM[started].pinHigh  = true;
+      PWM[started].pulsed   = true;
+      PWM[started].prevTime = edgeTime;
+
+      setMask         = PWM_GPIO_MASK(PWM[started].pin);
+      lane.channelNum = started;
+      lane.nextEdge   = edgeTime + PWM[started].onTime;
+    }
+    else
+    {
+      // Idle until the end of the frame, or the end of this pulse if the frame is overlong
+      uint64_t frameEnd = lane.frameStart + PWM_SERVO_FRAME_US;
+
+      lane.channelNum = -1;
+      lane.nextEdge   = (frameEnd > edgeTime) ? frameEnd : edgeTime + 1;
+    }
+
+#if PWM_PIPELINED_ISR
+
+    nextSetMask   |= setMask;
+    nextClearMask |= clearMask;
+
+    if (stopped >= 0)
+      nextStoppedChannels |= (1UL << stopped);
+
+    if (started >= 0)
+      nextStartedChannels |= (1UL << started);
+
+#else
+
+    // Both edges in the same masked write
+    PWM_writeGPIOMask(setMask, clearMask);
+
+    if (stopped >= 0)
+      pulseEdge(stopped, false);
+
+    if (started >= 0)
+      pulseEdge(started, true);
+
+#endif
+  }
+}
+
+///////////////////////////////////////////////////
+
+#if PWM_SERVO_ALARM_AVAILABLE
+
+void IRAM_ATTR ESP32_PWM_ISR::setServoAlarm(const uint64_t& currentTime)
+{
+  // Earliest servo edge still ahead
+  uint64_t nextEdge = 0;
+
+  for (uint8_t laneNum = 0; laneNum < PWM_SERVO_LANES; laneNum++)
+  {
+    if ( servoLanes[laneNum].mask && (servoLanes[laneNum].nextEdge > currentTime) && 
+         ( (nextEdge == 0) || (servoLanes[laneNum].nextEdge < nextEdge) ) )
+    {
+      nextEdge = servoLanes[laneNum].nextEdge;
+    }
+  }
+
+  uint64_t alarm = 0;
+
+  if (nextEdge)
+  {
+    // The counter restarts from 0 at each alarm. Read together with the time, as run() has already taken a while
+    uint64_t elapsed  = idleTimer->getAlarmLatencyFromISR();
+    uint64_t now      = timeNow();
+    uint32_t delay    = (nextEdge > now + PWM_SERVO_MIN_ALARM_US) ? nextEdge - now : PWM_SERVO_MIN_ALARM_US;
+
+    uint64_t edgeAlarm = elapsed + (uint64_t) delay * (TIMER_BASE_CLK / 1000000) / timerDivider;
+
+    // Only if sooner than the next tick
+    if (edgeAlarm < timerTicks)
+    {
+      alarm = edgeAlarm;
+    }
+  }
+
+  if (alarm != servoAlarm)
+  {
+    idleTimer->setAlarmFromISR(alarm ? alarm : timerTicks);
+    servoAlarm = alarm;
+  }
+}
+
+#endif
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::nextCycle(const uint8_t& channelNum, const uint64_t& channelTime)
+{
+  // Whole cycles skipped by a late run()
+  uint32_t lateCycles = ( (uint32_t) (channelTime - PWM[channelNum].prevTime) / PWM[channelNum].period ) - 1;
+
+  // A 0% / 100% dutycycle has no edge to miss, even when run() is paused while idle, see attachTimer()
+  bool hasEdges = ( PWM[channelNum].onTime > 0 ) && ( PWM[channelNum].onTime < PWM[channelNum].period );
+
+  // Pulse of this cycle lost, or not ended in time
+  bool missedEdge = hasEdges && ( PWM[channelNum].pinHigh || !PWM[channelNum].pulsed );
+
+  if ( hasEdges && (lateCycles || missedEdge) )
+  {
+    PWM[channelNum].overruns += lateCycles + missedEdge;
+
+    if ( (overrunPolicy == PWM_OVERRUN_MIN_PULSE) && missedEdge && !PWM[channelNum].complementary )
+    {
+      // The falling edge, or a whole pulse if lost, so that no pulse is lost, except in the skipped cycles
+#if PWM_PIPELINED_ISR
+      // In order with the other edges of this pass, at the next run()
+      if (!PWM[channelNum].pulsed)
+      {
+        nextPulseMask       |= PWM_GPIO_MASK(PWM[channelNum].pin);
+        nextPulsedChannels  |= (1UL << channelNum);
+      }
+      else
+      {
+        nextClearMask       |= PWM_GPIO_MASK(PWM[channelNum].pin);
+        nextStoppedChannels |= (1UL << channelNum);
+      }
+#else
+      if (!PWM[channelNum].pulsed)
+      {
+        digitalWrite(PWM[channelNum].pin, HIGH);
+        pulseEdge(channelNum, true);
+      }
+
+      digitalWrite(PWM[channelNum].pin, LOW);
+
+      pulseEdge(channelNum, false);
+#endif
+
+      PWM[channelNum].pinHigh = false;
+    }
+  }
+
+  PWM[channelNum].pulsed = false;
+
+  notifyEvent(channelNum, PWM_EVENT_CYCLE_END);
+
+  if (overrunPolicy == PWM_OVERRUN_COMPRESS)
+  {
+    // Keep the phase, even if late by whole cycles
+    PWM[channelNum].prevTime += (uint64_t) PWM[channelNum].period * (lateCycles + 1);
+  }
+  else if (PWM[channelNum].exactFreq || PWM[channelNum].ramping)
+  {
+    // Keep the phase : the new cycle starts when the previous one should have ended, not when the ISR noticed.
+    // Resync only if late by more than a whole period
+    PWM[channelNum].prevTime += PWM[channelNum].period;
+
+    if ( (uint32_t) (channelTime - PWM[channelNum].prevTime) >= PWM[channelNum].period )
+    {
+      PWM[channelNum].prevTime = channelTime;
+    }
+  }
+  else
+  {
+    PWM[channelNum].prevTime = channelTime;
+  }
+
+#if CHANGING_PWM_END_OF_CYCLE
+
+  // Only update whenever having newPeriod
+  if (PWM[channelNum].newPeriod != 0)
+  {
+    PWM[channelNum].basePeriod  = PWM[channelNum].newPeriod;
+    PWM[channelNum].newPeriod   = 0;
+
+    PWM[channelNum].baseOnTime  = PWM[channelNum].newOnTime;
+    PWM[channelNum].periodFrac  = PWM[channelNum].newPeriodFrac;
+    PWM[channelNum].onTimeFrac  = PWM[channelNum].newOnTimeFrac;
+  }
+
+#endif
+
+  // Trapezoidal ramp, the period of the new step. After the last one, the channel is stopped by the next run(),
+  // before the pulse of this cycle, unless already being deleted
+  if (PWM[channelNum].rampSteps)
+  {
+    startRampStep(channelNum);
+  }
+  else if ( PWM[channelNum].ramping && (PWM[channelNum].pendingOp == PWM_OP_NONE) )
+  {
+    PWM[channelNum].pendingOp = PWM_OP_DISABLE;
+  }
+
+  // DDS-style phase accumulators. A carry lengthens the next cycle / onTime by 1 us / ms
+  uint32_t acc = PWM[channelNum].periodAcc + PWM[channelNum].periodFrac;
+  PWM[channelNum].period    = PWM[channelNum].basePeriod + (acc < PWM[channelNum].periodAcc);
+  PWM[channelNum].periodAcc = acc;
+
+  acc = PWM[channelNum].onTimeAcc + PWM[channelNum].onTimeFrac;
+  PWM[channelNum].onTime    = PWM[channelNum].baseOnTime + (acc < PWM[channelNum].onTimeAcc);
+  PWM[channelNum].onTimeAcc = acc;
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::runLookAhead(uint32_t channels, const uint64_t& currentTime, const uint32_t& timeCycles)
+{
+  uint32_t startCycles = cpu_hal_get_cycle_count();
+
+  while (channels)
+  {
+    // Earliest edge first
+    uint8_t   channelNum  = 0;
+    uint32_t  delay       = 0xFFFFFFFF;
+
+    for (uint32_t remaining = channels; remaining; remaining &= remaining - 1)
+    {
+      uint8_t   channel       = __builtin_ctz(remaining);
+      uint32_t  channelDelay  = 0;
+
+      lookAheadDelay(channel, currentTime, channelDelay);
+
+      if (channelDelay < delay)
+      {
+        channelNum  = channel;
+        delay       = channelDelay;
+      }
+    }
+
+    channels &= ~(1UL << channelNum);
+
+    // Bounded by PWM_LOOKAHEAD_US
+    uint32_t dueCycles = timeCycles + delay * cyclesPerUs;
+
+    while ( (int32_t) (cpu_hal_get_cycle_count() - dueCycles) < 0 );
+
+    if (PWM[channelNum].pinHigh)
+    {
+      digitalWrite(PWM[channelNum].pin, LOW);
+      PWM[channelNum].pinHigh = false;
+
+      pulseEdge(channelNum, false);
+    }
+    else
+    {
+      // Unless already started by run(), the new cycle starts exactly now
+      if ( !PWM[channelNum].oneShot && ( (uint32_t) (currentTime - PWM[channelNum].prevTime) >= pulseEnd(channelNum) ) )
+      {
+        nextCycle(channelNum, currentTime + delay);
+
+        // End of a ramp, or no pulse in this cycle of a dithered channel
+        if ( PWM[channelNum].pendingOp || (pulseEnd(channelNum) == 0) )
+        {
+          continue;
+        }
+      }
+
+      digitalWrite(PWM[channelNum].pin, HIGH);
+      PWM[channelNum].pinHigh = true;
+      PWM[channelNum].pulsed  = true;
+
+      pulseEdge(channelNum, true);
+
+      // A short one-shot pulse may end within the look-ahead too
+      if ( PWM[channelNum].oneShot && lookAheadDelay(channelNum, currentTime, delay) )
+      {
+        channels |= (1UL << channelNum);
+      }
+    }
+  }
+
+  uint32_t spentCycles = cpu_hal_get_cycle_count() - startCycles;
+
+  if (spentCycles > maxLookAheadCycles)
+  {
+    maxLookAheadCycles = spentCycles;
+  }
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::startRampStep(const uint8_t& channelNum)
+{
+  uint32_t period = PWM[channelNum].rampPeriod;
+  uint64_t onTime = ( (uint64_t) period * PWM[channelNum].rampDuty ) >> 16;
+
+  // Integer and 1 / 2^32 fractional parts, for the DDS-style phase accumulators
+  PWM[channelNum].basePeriod  = period >> 8;
+  PWM[channelNum].periodFrac  = period << 24;
+  PWM[channelNum].baseOnTime  = onTime >> 8;
+  PWM[channelNum].onTimeFrac  = (uint32_t) onTime << 24;
+
+  // Last step
+  if (--PWM[channelNum].rampSteps == 0)
+  {
+    return;
+  }
+
+  // The last rampDecelSteps steps decelerate
+  if (PWM[channelNum].rampSteps == PWM[channelNum].rampDecelSteps)
+  {
+    PWM[channelNum].rampN = - (int32_t) PWM[channelNum].rampDecelSteps;
+  }
+
+  if ( (PWM[channelNum].rampN < 0) || (period > PWM[channelNum].rampMinPeriod) )
+  {
+    // AVR446 recurrence : c(n) = c(n - 1) - 2 * c(n - 1) / (4 * n + 1), the remainder being carried to the next step.
+    // n < 0 while decelerating, so that the period grows back
+    int64_t num   = 2 * (int64_t) period + PWM[channelNum].rampRest;
+    int32_t denom = 4 * PWM[channelNum].rampN + 1;
+
+    period                    -= (int32_t) (num / denom);
+    PWM[channelNum].rampRest  = num % denom;
+    PWM[channelNum].rampN++;
+
+    // Cruise
+    if ( (PWM[channelNum].rampN > 0) && (period < PWM[channelNum].rampMinPeriod) )
+    {
+      period                    = PWM[channelNum].rampMinPeriod;
+      PWM[channelNum].rampRest  = 0;
+    }
+
+    PWM[channelNum].rampPeriod = period;
+  }
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::applyPendingOp(const uint8_t& channelNum)
+{
+  // A new request posted from now on will be seen by the next run()
+  uint32_t op = __atomic_exchange_n(&PWM[channelNum].pendingOp, PWM_OP_NONE, __ATOMIC_ACQ_REL);
+
+  if (op != PWM_OP_NONE)
+  {
+    stopChannel(channelNum, op == PWM_OP_DELETE);
+  }
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::stopChannel(const uint8_t& channelNum, const bool& freeChannel)
+{
+  cancelPendingEdges(channelNum);
+
+  if (PWM[channelNum].complementary)
+  {
+    // Output B is always left LOW, so that both outputs are never HIGH together
+    PWM_writeGPIOMask(0, PWM_GPIO_MASK(PWM[channelNum].pinB));
+    PWM[channelNum].pinBHigh = false;
+  }
+
+  digitalWrite(PWM[channelNum].pin, PWM[channelNum].stopLevel);
+
+  PWM[channelNum].pinHigh = (PWM[channelNum].stopLevel == HIGH);
+  PWM[channelNum].enabled = false;
+
+  // End of the ramp, or ramp aborted
+  if (PWM[channelNum].ramping)
+  {
+    if (PWM[channelNum].rampSteps == 0)
+    {
+      notifyEvent(channelNum, PWM_EVENT_RAMP_DONE);
+    }
+
+    PWM[channelNum].ramping   = false;
+    PWM[channelNum].rampSteps = 0;
+  }
+
+  notifyEvent(channelNum, PWM_EVENT_STOPPED);
+
+  // A one-shot pulse can't be enabled again : disabling it, e.g. by disableAll(), cancels it and frees its slot
+  if (freeChannel || PWM[channelNum].oneShot)
+  {
+    if (PWM[channelNum].servo)
+    {
+      // The lane keeps its schedule, the next servo starting when this pulse would have ended
+      servoLanes[PWM[channelNum].servoLane].mask &= ~(1UL << channelNum);
+      servoLanes[PWM[channelNum].servoLane].load -= PWM[channelNum].servoMax;
+    }
+
+    uint32_t pin = PWM[channelNum].pin;
+
+    if ( (pin < PWM_MAX_PINS) && (pinToChannel[pin] == channelNum) )
+    {
+      pinToChannel[pin] = -1;
+    }
+
+    pin = PWM[channelNum].pinB;
+
+    if ( PWM[channelNum].complementary && (pin < PWM_MAX_PINS) && (pinToChannel[pin] == channelNum) )
+    {
+      pinToChannel[pin] = -1;
+    }
+
+    // Any handle to the old channel is now stale
+    generation[channelNum]++;
+    freeMask |= (1UL << channelNum);
+
+    memset((void*) &PWM[channelNum], 0, sizeof (PWM_t));
+
+    PWM[channelNum].pin = INVALID_ESP32_PIN;
+
+    // update number of channels
+    numChannels--;
+  }
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::attachTimer(ESP32TimerInterrupt* timer)
+{
+  // Don't leave the previous timer paused
+  wakeTimer();
+  
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  idleTimer = timer;
+
+#if PWM_SERVO_ALARM_AVAILABLE
+
+  if (timer)
+  {
+    timerTicks    = timer->getTicks();
+    timerDivider  = timer->getDivider();
+  }
+  
+  servoAlarm = 0;
+
+#endif
+
+#if PWM_PIPELINED_ISR
+
+  // The look-ahead of run() never goes beyond the timer interval, in us / ms
+  maxLookAhead = timer ? (uint32_t) ( timer->getTicks() * timer->getDivider() / 
+                                      ( TIMER_BASE_CLK / ( USING_MICROS_RESOLUTION ? 1000000 : 1000 ) ) ) : 0xFFFFFFFF;
+  
+  resetLookAhead();
+
+#endif
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+}
+
+///////////////////////////////////////////////////
+
+uint64_t IRAM_ATTR ESP32_PWM_ISR::channelTimeNow(const uint8_t& channelNum)
+{
+  return (PWM[channelNum].precision == PWM_PRECISION_COARSE) ? timeNowCoarse() : timeNow();
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::wakeTimer()
+{
+  if (!idleTimer)
+  {
+    return;
+  }
+  
+  // timerIdle is only set by run(), with PWM_Mux held. So either run() has seen the change, made before this call,
+  // or timerIdle is seen here. Even a lock-free change, such as a deferred disable, is never missed
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  bool wasIdle = timerIdle;
+  timerIdle    = false;
+
+#if PWM_PIPELINED_ISR
+
+  if (wasIdle)
+  {
+    resetLookAhead();
+  }
+
+#endif
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  if (wasIdle)
+  {
+    idleTimer->resumeAlarm();
+  }
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::wakeTimerFromISR()
+{
+  if (idleTimer && timerIdle)
+  {
+    timerIdle = false;
+
+#if PWM_PIPELINED_ISR
+    resetLookAhead();
+#endif
+
+    idleTimer->resumeAlarmFromISR();
+  }
+}
+
+///////////////////////////////////////////////////
+
+// find the first available slot
+// return -1 if none found
+int ESP32_PWM_ISR::findFirstFreeSlot()
+{
+  // all slots are used
+  if (freeMask == 0)
+  {
+    return -1;
+  }
+
+  // lowest free slot, in O(1)
+  return __builtin_ctz(freeMask);
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_PWM_ISR::setupPWMChannel(const uint32_t& pin, const uint32_t& period, const float& dutycycle,
+                                   void* cbStartFunc, void* cbStopFunc, const bool& exactFreq, const uint32_t& periodFrac,
+                                   const uint8_t& precision, const bool& dithered)
+{
+  int channelNum;
+
+  // Invalid input, such as period = 0, etc
+  if ( (period == 0) || (dutycycle < 0.0) || (dutycycle > 100.0) )
+  {
+    PWM_LOGERROR("Error: Invalid period or dutycycle");
+    return -1;
+  }
+
+  if (numChannels < 0)
+  {
+    init();
+  }
+
+  uint32_t onTime     = ( period * dutycycle ) / 100;
+  uint32_t onTimeFrac = 0;
+
+  if (exactFreq || dithered)
+  {
+    calculateOnTime(period, exactFreq ? periodFrac : 0, dutycycle, onTime, onTimeFrac);
+  }
+
+  pinMode(pin, OUTPUT);
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  channelNum = allocPWMChannel(pin, period, onTime, exactFreq, periodFrac, onTimeFrac, cbStartFunc, cbStopFunc, 
+                               (precision == PWM_PRECISION_COARSE) ? timeNowCoarse() : timeNow());
+
+  if (channelNum >= 0)
+  {
+    PWM[channelNum].precision   = precision;
+    PWM[channelNum].dithered    = dithered;
+    PWM[channelNum].onTimeFrac  = onTimeFrac;
+    
+    digitalWrite(pin, HIGH);
+
+    PWM[channelNum].enabled     = true;
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+
+  if (channelNum < 0)
+  {
+    PWM_LOGERROR("Error: No free PWM channel");
+    return -1;
+  }
+
+  PWM_LOGINFO_LINE("Channel : ", channelNum,
+                   "\t    Period : ", PWM[channelNum].period,
+                   "\t\tOnTime : ", PWM[channelNum].onTime,
+                   "\tStart_Time : ", PWM[channelNum].prevTime);
+
+  return channelNum;
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_PWM_ISR::allocPWMChannel(const uint32_t& pin, const uint32_t& period, const uint32_t& onTime, const bool& exactFreq,
+                                   const uint32_t& periodFrac, const uint32_t& onTimeFrac, void* cbStartFunc, void* cbStopFunc,
+                                   const uint64_t& startTime, const int8_t& slot)
+{
+  // Find and claim the slot at once, run() may free another slot concurrently
+  int channelNum = (slot < 0) ? findFirstFreeSlot() : slot;
+
+  if (channelNum < 0)
+  {
+    return -1;
+  }
+
+  freeMask &= ~(1UL << channelNum);
+
+  if (pin < PWM_MAX_PINS)
+  {
+    pinToChannel[pin] = channelNum;
+  }
+
+  PWM[channelNum].pin           = pin;
+  PWM[channelNum].period        = period;
+  PWM[channelNum].onTime        = onTime;
+
+  // Must be 0 for new PWM channel
+  PWM[channelNum].newPeriod     = 0;
+
+  PWM[channelNum].exactFreq     = exactFreq;
+  PWM[channelNum].dithered      = false;
+  PWM[channelNum].basePeriod    = period;
+  PWM[channelNum].baseOnTime    = onTime;
+  PWM[channelNum].periodFrac    = exactFreq ? periodFrac : 0;
+  PWM[channelNum].onTimeFrac    = exactFreq ? onTimeFrac : 0;
+  PWM[channelNum].periodAcc     = 0;
+  PWM[channelNum].onTimeAcc     = 0;
+
+  // The caller drives the pin HIGH, as the first cycle starts now
+  PWM[channelNum].pinHigh       = true;
+  PWM[channelNum].pulsed        = true;
+  PWM[channelNum].overruns      = 0;
+
+  PWM[channelNum].prevTime      = startTime;
+
+  PWM[channelNum].callbackStart = cbStartFunc;
+  PWM[channelNum].callbackStop  = cbStopFunc;
+
+  PWM[channelNum].pendingOp     = PWM_OP_NONE;
+  PWM[channelNum].stopLevel     = LOW;
+
+  PWM[channelNum].complementary = false;
+  PWM[channelNum].pinBHigh      = false;
+  
+  PWM[channelNum].precision     = PWM_PRECISION_FINE;
+  PWM[channelNum].highPrecision = false;
+  PWM[channelNum].servo         = false;
+  PWM[channelNum].oneShot       = false;
+  PWM[channelNum].ramping       = false;
+  PWM[channelNum].rampSteps     = 0;
+
+  // run() may free a deleted channel concurrently
+  numChannels++;
+
+  return channelNum;
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_PWM_ISR::setPWM_Complementary(const uint32_t& pinA, const uint32_t& pinB, const float& frequency,
+                                        const float& dutycycle, const uint32_t& deadTime)
+{
+  uint32_t period = 0;
+
+  if ( ( frequency > 0.0 ) && ( frequency <= 500.0 ) )
+  {
+#if USING_MICROS_RESOLUTION
+    // period in us
+    period = 1000000.0f / frequency;
+#else
+    // period in ms
+    period = 1000.0f / frequency;
+#endif
+  }
+  else
+  {
+    PWM_LOGERROR("Error: Invalid frequency, max is 500Hz");
+    return -1;
+  }
+
+  // Invalid input, such as period = 0, etc
+  if ( (period == 0) || (dutycycle < 0.0) || (dutycycle > 100.0) || ( 2 * deadTime >= period ) )
+  {
+    PWM_LOGERROR("Error: Invalid period, dutycycle or deadTime");
+    return -1;
+  }
+
+  // Both pins are written by the same masked GPIO update
+  if ( (pinA >= PWM_MAX_PINS) || (pinB >= PWM_MAX_PINS) || (pinA == pinB) )
+  {
+    PWM_LOGERROR("Error: Invalid pins");
+    return -1;
+  }
+
+  if (numChannels < 0)
+  {
+    init();
+  }
+
+  uint32_t onTime = ( period * dutycycle ) / 100;
+
+  // Both outputs LOW before being used as outputs
+  PWM_writeGPIOMask(0, PWM_GPIO_MASK(pinA) | PWM_GPIO_MASK(pinB));
+
+  pinMode(pinA, OUTPUT);
+  pinMode(pinB, OUTPUT);
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  int channelNum = allocPWMChannel(pinA, period, onTime, false, 0, 0, nullptr, nullptr, timeNow());
+
+  if (channelNum >= 0)
+  {
+    pinToChannel[pinB]              = channelNum;
+
+    PWM[channelNum].complementary   = true;
+    PWM[channelNum].pinB            = pinB;
+    PWM[channelNum].deadTime        = deadTime;
+
+    // Output A goes HIGH at next run()
+    PWM[channelNum].pinHigh         = false;
+
+    PWM[channelNum].enabled         = true;
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+
+  if (channelNum < 0)
+  {
+    PWM_LOGERROR("Error: No free PWM channel");
+    return -1;
+  }
+
+  PWM_LOGINFO_LINE("Channel : ", channelNum,
+                   "\t    Period : ", period,
+                   "\t\tOnTime : ", onTime,
+                   "\tDeadTime : ", deadTime);
+
+  return channelNum;
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_PWM_ISR::setPWMBatch(const uint32_t* pins, const float* frequencies, const float* dutycycles, const uint8_t& count,
+                               int* channelNums)
+{
+  uint32_t period[MAX_NUMBER_CHANNELS];
+  uint32_t onTime[MAX_NUMBER_CHANNELS];
+  int      channelNum[MAX_NUMBER_CHANNELS];
+
+  if ( (count == 0) || (count > MAX_NUMBER_CHANNELS) )
+  {
+    PWM_LOGERROR("Error: Invalid count");
+    return -1;
+  }
+
+  // Check and compute everything first, so that either all or none of the channels are created
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if ( ( frequencies[i] <= 0.0 ) || ( frequencies[i] > 500.0 ) || (dutycycles[i] < 0.0) || (dutycycles[i] > 100.0) )
+    {
+      PWM_LOGERROR("Error: Invalid frequency or dutycycle, max frequency is 500Hz");
+      return -1;
+    }
+
+#if USING_MICROS_RESOLUTION
+    // period in us
+    period[i] = 1000000.0f / frequencies[i];
+#else
+    // period in ms
+    period[i] = 1000.0f / frequencies[i];
+#endif
+
+    if (period[i] == 0)
+    {
+      PWM_LOGERROR("Error: Invalid period");
+      return -1;
+    }
+
+    onTime[i] = ( period[i] * dutycycles[i] ) / 100;
+  }
+
+  if (numChannels < 0)
+  {
+    init();
+  }
+
+  // Initialise all the pins in one pass, before any channel starts
+  PWM_GPIO_Mask_t pinMask = 0;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    pinMode(pins[i], OUTPUT);
+
+    pinMask |= PWM_GPIO_MASK(pins[i]);
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  if (__builtin_popcount(freeMask) < count)
+  {
+    endStateWrite();
+
+    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+    portEXIT_CRITICAL(&PWM_Mux);
+
+    PWM_LOGERROR("Error: Not enough free PWM channels");
+    return -1;
+  }
+
+  // Common start instant for all the new channels
+  uint64_t startTime = timeNow();
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    channelNum[i] = allocPWMChannel(pins[i], period[i], onTime[i], false, 0, 0, nullptr, nullptr, startTime);
+  }
+
+  // All pins HIGH at once
+  PWM_writeGPIOMask(pinMask, 0);
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    // No mask bit for pins >= 64
+    if (pins[i] >= PWM_MAX_PINS)
+    {
+      digitalWrite(pins[i], HIGH);
+    }
+
+    PWM[channelNum[i]].enabled = true;
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+
+  if (channelNums)
+  {
+    memcpy(channelNums, channelNum, count * sizeof(int));
+  }
+
+  PWM_LOGINFO1("Batch channels : ", count);
+  PWM_LOGINFO1("Start_Time : ", startTime);
+
+  return count;
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_PWM_ISR::modifyPWMChannel_Period(const uint8_t& channelNum, const uint32_t& pin, const uint32_t& period,
+                                            const float& dutycycle, const uint32_t& periodFrac)
+{
+  // Invalid input, such as period = 0, etc
+  if ( (period == 0) || (dutycycle < 0.0) || (dutycycle > 100.0) )
+  {
+    PWM_LOGERROR("Error: Invalid period or dutycycle");
+    return false;
+  }
+
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    PWM_LOGERROR("Error: channelNum >= MAX_NUMBER_CHANNELS");
+    return false;
+  }
+
+  if (PWM[channelNum].servo)
+  {
+    PWM_LOGERROR("Error: Servo channel, use setServoPulse()");
+    return false;
+  }
+
+  if (PWM[channelNum].pin != pin)
+  {
+    PWM_LOGERROR("Error: channelNum and pin mismatched");
+    return false;
+  }
+
+  uint32_t onTime     = ( period * dutycycle ) / 100;
+  uint32_t onTimeFrac = 0;
+  
+  // Fractional parts are only used by the channels created by setPWM_Exact(), or setPWM_Dithered() for the onTime
+  uint32_t exactPeriodFrac = PWM[channelNum].exactFreq ? periodFrac : 0;
+
+  if (hasOnTimeFrac(channelNum))
+  {
+    calculateOnTime(period, exactPeriodFrac, dutycycle, onTime, onTimeFrac);
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  setPeriod(channelNum, period, exactPeriodFrac, onTime, onTimeFrac);
+  setNewDutyCycle(channelNum, dutycycle);
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+
+  PWM_LOGINFO_LINE("Channel : ", channelNum,
+                   "\t    Period : ", period,
+                   "\t\tOnTime : ", onTime,
+                   "\tStart_Time : ", PWM[channelNum].prevTime);
+
+  return true;
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_PWM_ISR::modifyDutyBatch(const uint8_t* channelNums, const float* dutycycles, const uint8_t& count)
+{
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if ( (channelNums[i] >= MAX_NUMBER_CHANNELS) || (PWM[channelNums[i]].period == 0) || PWM[channelNums[i]].servo || 
+         (dutycycles[i] < 0.0) || (dutycycles[i] > 100.0) )
+    {
+      PWM_LOGERROR("Error: Invalid channelNum or dutycycle");
+      return false;
+    }
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint32_t period;
+    uint32_t periodFrac;
+
+    nextPeriod(channelNums[i], period, periodFrac);
+
+    uint32_t onTime     = ( period * dutycycles[i] ) / 100;
+    uint32_t onTimeFrac = 0;
+
+    if (hasOnTimeFrac(channelNums[i]))
+    {
+      calculateOnTime(period, periodFrac, dutycycles[i], onTime, onTimeFrac);
+    }
+
+    setOnTime(channelNums[i], period, periodFrac, onTime, onTimeFrac);
+    setNewDutyCycle(channelNums[i], dutycycles[i]);
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+
+  return true;
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_PWM_ISR::modifyDutyFraction(const uint8_t& channelNum, const uint16_t& dutyFraction)
+{
+  if ( (channelNum >= MAX_NUMBER_CHANNELS) || (PWM[channelNum].period == 0) || PWM[channelNum].servo )
+  {
+    PWM_LOGERROR("Error: Invalid channelNum");
+    return false;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  setDutyFraction(channelNum, dutyFraction);
+  setNewDutyCycle(channelNum, dutyFraction * ( 100.0f / PWM_MAX_DUTY_FRACTION ));
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+
+  return true;
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::nextPeriod(const uint8_t& channelNum, uint32_t& period, uint32_t& periodFrac)
+{
+#if CHANGING_PWM_END_OF_CYCLE
+
+  // Keep the period already waiting to be applied, if any
+  period      = PWM[channelNum].newPeriod ? PWM[channelNum].newPeriod : PWM[channelNum].basePeriod;
+  periodFrac  = PWM[channelNum].newPeriod ? PWM[channelNum].newPeriodFrac : PWM[channelNum].periodFrac;
+
+#else
+
+  period      = PWM[channelNum].basePeriod;
+  periodFrac  = PWM[channelNum].periodFrac;
+
+#endif
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::setOnTime(const uint8_t& channelNum, const uint32_t& period, const uint32_t& periodFrac, 
+                                        const uint32_t& onTime, const uint32_t& onTimeFrac)
+{
+  volatile PWM_t& channel = PWM[channelNum];
+
+#if CHANGING_PWM_END_OF_CYCLE
+
+  channel.newPeriodFrac = periodFrac;
+  channel.newOnTimeFrac = onTimeFrac;
+  channel.newOnTime     = onTime;
+
+  // Written last, as the ISR applies the new settings whenever newPeriod != 0
+  channel.newPeriod     = period;
+
+#else
+
+  (void) period;
+  (void) periodFrac;
+
+  // Same period, so no need to restart the cycle
+  channel.onTime        = onTime;
+  channel.baseOnTime    = onTime;
+  channel.onTimeFrac    = onTimeFrac;
+
+#endif
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::setPeriod(const uint8_t& channelNum, const uint32_t& period, const uint32_t& periodFrac, 
+                                        const uint32_t& onTime, const uint32_t& onTimeFrac)
+{
+#if CHANGING_PWM_END_OF_CYCLE
+
+  PWM[channelNum].newPeriodFrac = periodFrac;
+  PWM[channelNum].newOnTimeFrac = onTimeFrac;
+  PWM[channelNum].newOnTime     = onTime;
+  
+  // Written last, as the ISR applies the new settings whenever newPeriod != 0
+  PWM[channelNum].newPeriod     = period;
+
+#else
+
+  PWM[channelNum].period        = period;
+  PWM[channelNum].onTime        = onTime;
+  
+  PWM[channelNum].basePeriod    = period;
+  PWM[channelNum].baseOnTime    = onTime;
+  PWM[channelNum].periodFrac    = periodFrac;
+  PWM[channelNum].onTimeFrac    = onTimeFrac;
+
+  cancelPendingEdges(channelNum);
+
+  digitalWrite(PWM[channelNum].pin, HIGH);
+  PWM[channelNum].pinHigh       = true;
+  PWM[channelNum].pulsed        = true;
+
+  PWM[channelNum].prevTime      = channelTimeNow(channelNum);
+
+#endif
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::setDutyFraction(const uint8_t& channelNum, const uint16_t& dutyFraction)
+{
+  // 0 - 65535 to 0 - 65536, so that PWM_MAX_DUTY_FRACTION is the whole period
+  uint32_t duty = dutyFraction + (dutyFraction >> 15);
+
+  uint32_t period;
+  uint32_t periodFrac;
+
+  nextPeriod(channelNum, period, periodFrac);
+
+  // onTime in 1/65536 us / ms
+  uint64_t exactOnTime  = (uint64_t) period * duty;
+  uint32_t onTime       = exactOnTime >> 16;
+  uint32_t onTimeFrac   = 0;
+
+  if (hasOnTimeFrac(channelNum))
+  {
+    // 2^-32 fraction, from both the onTime remainder and the periodFrac share
+    uint64_t frac = ( (exactOnTime & 0xFFFF) << 16 ) + ( ( (uint64_t) periodFrac * duty ) >> 16 );
+
+    onTime     += frac >> 32;
+    onTimeFrac  = (uint32_t) frac;
+  }
+
+  setOnTime(channelNum, period, periodFrac, onTime, onTimeFrac);
+}
+
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::requestOp(const uint8_t& channelNum, const uint32_t& op)
+{
+#if CHANGING_PWM_END_OF_CYCLE
+
+  // Lock-free. run() applies the request at the end of the current pulse.
+  // A disabled channel is not serviced by run(), so it can be stopped right away
+  if (PWM[channelNum].enabled)
+  {
+    __atomic_store_n(&PWM[channelNum].pendingOp, op, __ATOMIC_RELEASE);
+
+    wakeTimer();
+
+    return;
+  }
+
+#endif
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  // Check again, run() may have freed the channel meanwhile
+  if (PWM[channelNum].period != 0)
+  {
+    PWM[channelNum].pendingOp = PWM_OP_NONE;
+
+    stopChannel(channelNum, op == PWM_OP_DELETE);
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::deleteChannel(const uint8_t& channelNum)
+{
+  // nothing to delete if no timers are in use
+  if ( (channelNum >= MAX_NUMBER_CHANNELS)  || (numChannels <= 0) )
+  {
+    return;
+  }
+
+  // don't decrease the number of timers if the specified slot is already empty (zero period, invalid)
+  if ( (PWM[channelNum].pin != INVALID_ESP32_PIN) && (PWM[channelNum].period != 0) )
+  {
+    requestOp(channelNum, PWM_OP_DELETE);
+  }
+}
+
+///////////////////////////////////////////////////
+
+// function contributed by code@rowansimms.com
+void ESP32_PWM_ISR::restartChannel(const uint8_t& channelNum)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  PWM[channelNum].prevTime = channelTimeNow(channelNum);
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_PWM_ISR::isEnabled(const uint8_t& channelNum)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return false;
+  }
+
+  return PWM[channelNum].enabled;
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::enable(const uint8_t& channelNum)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  startChannel(channelNum);
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_PWM_ISR::startChannel(const uint8_t& channelNum)
+{
+  // A one-shot pulse is only started by firePulseFromISR()
+  if (PWM[channelNum].oneShot)
+  {
+    return;
+  }
+
+  // Enabling cancels a pending disable. A pending delete is never cancelled
+  if (PWM[channelNum].pendingOp == PWM_OP_DISABLE)
+  {
+    PWM[channelNum].pendingOp = PWM_OP_NONE;
+  }
+
+  if ( !PWM[channelNum].enabled && (PWM[channelNum].period != 0) )
+  {
+    // Start a whole new cycle, HIGH at next run()
+    PWM[channelNum].pinHigh   = false;
+    PWM[channelNum].pulsed    = false;
+    PWM[channelNum].prevTime  = channelTimeNow(channelNum);
+    PWM[channelNum].enabled   = true;
+  }
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::disable(const uint8_t& channelNum)
+{
+  if ( (channelNum >= MAX_NUMBER_CHANNELS) || (PWM[channelNum].period == 0) )
+  {
+    return;
+  }
+
+  if (PWM[channelNum].pendingOp == PWM_OP_NONE)
+  {
+    requestOp(channelNum, PWM_OP_DISABLE);
+  }
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::setStopLevel(const uint8_t& channelNum, const uint8_t& level)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return;
+  }
+
+  PWM[channelNum].stopLevel = level;
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::enableAll()
+{
+  // Enable all timers with a callbackStart assigned (used)
+  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_CHANNELS; channelNum++)
+  {
+    if (PWM[channelNum].period != 0)
+    {
+      enable(channelNum);
+    }
+  }
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::disableAll()
+{
+  // Disable all timers with a callbackStart assigned (used)
+  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_CHANNELS; channelNum++)
+  {
+    if (PWM[channelNum].period != 0)
+    {
+      disable(channelNum);
+    }
+  }
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::toggle(const uint8_t& channelNum)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return;
+  }
+
+  // A channel with a pending disable is considered as already disabled
+  if (PWM[channelNum].enabled && (PWM[channelNum].pendingOp == PWM_OP_NONE) )
+  {
+    disable(channelNum);
+  }
+  else
+  {
+    enable(channelNum);
+  }
+}
+
+///////////////////////////////////////////////////
+
+bool IRAM_ATTR ESP32_PWM_ISR::modifyPWMChannel_PeriodFromISR(const uint8_t& channelNum, const uint32_t& pin, 
+                                                             const uint32_t& period, const uint16_t& dutyFraction)
+{
+  if ( (channelNum >= MAX_NUMBER_CHANNELS) || (period == 0) )
+  {
+    return false;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portENTER_CRITICAL_ISR(&PWM_Mux);
+
+  // Checked with PWM_Mux held, as a task on the other core may be changing the channel
+  bool valid = (PWM[channelNum].period != 0) && (PWM[channelNum].pin == pin) && !PWM[channelNum].servo;
+
+  if (valid)
+  {
+    beginStateWrite();
+
+    // The onTime follows the new period, as set by setDutyFraction() from nextPeriod()
+    setPeriod(channelNum, period, 0, 0, 0);
+    setDutyFraction(channelNum, dutyFraction);
+
+    endStateWrite();
+
+    wakeTimerFromISR();
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&PWM_Mux);
+
+  return valid;
+}
+
+///////////////////////////////////////////////////
+
+bool IRAM_ATTR ESP32_PWM_ISR::modifyDutyFractionFromISR(const uint8_t& channelNum, const uint16_t& dutyFraction)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return false;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portENTER_CRITICAL_ISR(&PWM_Mux);
+
+  bool valid = (PWM[channelNum].period != 0) && !PWM[channelNum].servo;
+
+  if (valid)
+  {
+    beginStateWrite();
+
+    setDutyFraction(channelNum, dutyFraction);
+
+    endStateWrite();
+
+    wakeTimerFromISR();
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&PWM_Mux);
+
+  return valid;
+}
+
+///////////////////////////////////////////////////
+
+bool IRAM_ATTR ESP32_PWM_ISR::enableFromISR(const uint8_t& channelNum)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return false;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portENTER_CRITICAL_ISR(&PWM_Mux);
+
+  bool valid = (PWM[channelNum].period != 0) && !PWM[channelNum].oneShot;
+
+  if (valid)
+  {
+    beginStateWrite();
+
+    startChannel(channelNum);
+
+    endStateWrite();
+
+    wakeTimerFromISR();
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&PWM_Mux);
+
+  return valid;
+}
+
+///////////////////////////////////////////////////
+
+bool IRAM_ATTR ESP32_PWM_ISR::disableFromISR(const uint8_t& channelNum)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return false;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portENTER_CRITICAL_ISR(&PWM_Mux);
+
+  bool valid = (PWM[channelNum].period != 0);
+
+  if ( valid && (PWM[channelNum].pendingOp == PWM_OP_NONE) )
+  {
+#if CHANGING_PWM_END_OF_CYCLE
+
+    // As disable(), run() stops the channel at the end of the current pulse
+    if (PWM[channelNum].enabled)
+    {
+      PWM[channelNum].pendingOp = PWM_OP_DISABLE;
+
+      wakeTimerFromISR();
+    }
+    else
+
+#endif
+    {
+      beginStateWrite();
+
+      stopChannel(channelNum, false);
+
+      endStateWrite();
+    }
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&PWM_Mux);
+
+  return valid;
+}
+
+///////////////////////////////////////////////////
+
+bool IRAM_ATTR ESP32_PWM_ISR::restartChannelFromISR(const uint8_t& channelNum)
+{
+  if (channelNum >= MAX_NUMBER_CHANNELS)
+  {
+    return false;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portENTER_CRITICAL_ISR(&PWM_Mux);
+
+  bool valid = (PWM[channelNum].period != 0);
+
+  if (valid)
+  {
+    beginStateWrite();
+
+    PWM[channelNum].prevTime = channelTimeNow(channelNum);
+
+    endStateWrite();
+
+    wakeTimerFromISR();
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&PWM_Mux);
+
+  return valid;
+}
+
+///////////////////////////////////////////////////
+
+int8_t ESP32_PWM_ISR::getnumChannels()
+{
+  return numChannels;
+}
+
+///////////////////////////////////////////////////
+
+void ESP32_PWM_ISR::copyChannelStates(const uint8_t& firstChannel, const uint8_t& count, PWM_ChannelState_t* states)
+{
+  uint32_t seq;
+
+  do
+  {
+    // Wait for the end of a change in progress, by run() or on the other core
+    while ( (seq = __atomic_load_n(&stateSeq, __ATOMIC_ACQUIRE)) & 1 );
+
+    uint64_t currentTime  = timeNow();
+    uint64_t coarseTime   = timeNowCoarse();
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      volatile PWM_t&       channel = PWM[firstChannel + i];
+      PWM_ChannelState_t&   state   = states[i];
+
+      state.pin           = (channel.period != 0) ? channel.pin : INVALID_ESP32_PIN;
+      state.pinB          = channel.pinB;
+      state.enabled       = channel.enabled;
+      state.pinHigh       = channel.pinHigh;
+      state.pinBHigh      = channel.pinBHigh;
+      state.exactFreq     = channel.exactFreq;
+      state.dithered      = channel.dithered;
+      state.complementary = channel.complementary;
+      state.precision     = channel.precision;
+      state.stopLevel     = channel.stopLevel;
+      state.pendingOp     = channel.pendingOp;
+      state.period        = channel.period;
+      state.onTime        = channel.onTime;
+      state.phase         = (uint32_t) ( ( (channel.precision == PWM_PRECISION_COARSE) ? coarseTime : currentTime ) 
+                                         - channel.prevTime );
+      state.newPeriod     = channel.newPeriod;
+      state.newOnTime     = channel.newOnTime;
+      state.newDutyCycle  = channel.newDutyCycle;
+      state.deadTime      = channel.deadTime;
+      state.overruns      = channel.overruns;
+      state.highPrecision = channel.highPrecision;
+      state.servo         = channel.servo;
+      state.oneShot       = channel.oneShot;
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (__atomic_load_n(&stateSeq, __ATOMIC_RELAXED) != seq);
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_PWM_ISR::getChannelState(const uint8_t& channelNum, PWM_ChannelState_t& state)
+{
+  if ( (channelNum >= MAX_NUMBER_CHANNELS) || (numChannels <= 0) )
+  {
+    return false;
+  }
+
+  copyChannelStates(channelNum, 1, &state);
+
+  return (state.pin != INVALID_ESP32_PIN);
+}
+
+///////////////////////////////////////////////////
+
+int8_t ESP32_PWM_ISR::getAllChannelStates(PWM_ChannelState_t states[MAX_NUMBER_CHANNELS])
+{
+  if (numChannels < 0)
+  {
+    for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_CHANNELS; channelNum++)
+    {
+      memset(&states[channelNum], 0, sizeof(PWM_ChannelState_t));
+      states[channelNum].pin = INVALID_ESP32_PIN;
+    }
+
+    return 0;
+  }
+
+  copyChannelStates(0, MAX_NUMBER_CHANNELS, states);
+
+  return numChannels;
+}
+
+///////////////////////////////////////////////////
+
+size_t ESP32_PWM_ISR::saveSnapshot(void* buffer, const size_t& size)
+{
+  PWM_SnapshotHeader_t  header;
+  PWM_SnapshotChannel_t channels[MAX_NUMBER_CHANNELS];
+
+  if (buffer == nullptr)
+  {
+    PWM_LOGERROR("Error: Invalid buffer");
+    return 0;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memset(channels, 0, sizeof(channels));
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  // All phases at the same instant
+  uint64_t currentTime  = timeNow();
+  uint64_t coarseTime   = timeNowCoarse();
+
+  for (uint8_t channelNum = 0; (numChannels > 0) && (channelNum < MAX_NUMBER_CHANNELS); channelNum++)
+  {
+    volatile PWM_t& channel = PWM[channelNum];
+
+    if ( (channel.period == 0) || channel.servo || channel.oneShot || channel.ramping || 
+         (channel.pendingOp == PWM_OP_DELETE) )
+    {
+      continue;
+    }
+
+    PWM_SnapshotChannel_t& record = channels[header.count++];
+
+    record.channelNum   = channelNum;
+    record.pin          = channel.pin;
+    record.pinB         = channel.complementary ? channel.pinB : INVALID_ESP32_PIN;
+    record.flags        = ( channel.exactFreq ? PWM_SNAPSHOT_EXACT : 0 ) | ( channel.dithered ? PWM_SNAPSHOT_DITHERED : 0 ) |
+                          ( channel.complementary ? PWM_SNAPSHOT_COMPLEMENTARY : 0 ) |
+                          ( (channel.precision == PWM_PRECISION_COARSE) ? PWM_SNAPSHOT_COARSE : 0 ) |
+                          ( channel.highPrecision ? PWM_SNAPSHOT_HIGH_PRECISION : 0 ) |
+                          ( channel.stopLevel ? PWM_SNAPSHOT_STOP_HIGH : 0 );
+    record.period       = channel.basePeriod;
+    record.onTime       = channel.baseOnTime;
+    record.periodFrac   = channel.periodFrac;
+    record.onTimeFrac   = channel.onTimeFrac;
+    record.deadTime     = channel.deadTime;
+
+#if CHANGING_PWM_END_OF_CYCLE
+
+    if (channel.newPeriod != 0)
+    {
+      record.period     = channel.newPeriod;
+      record.onTime     = channel.newOnTime;
+      record.periodFrac = channel.newPeriodFrac;
+      record.onTimeFrac = channel.newOnTimeFrac;
+    }
+
+#endif
+
+    // A pending disable is saved as already applied
+    if (channel.enabled && (channel.pendingOp == PWM_OP_NONE) )
+    {
+      header.enableMask |= (1UL << channelNum);
+
+      uint64_t channelTime = (channel.precision == PWM_PRECISION_COARSE) ? coarseTime : currentTime;
+
+      record.phase = (uint32_t) (channelTime - channel.prevTime);
+    }
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  size_t snapshotSize = PWM_SNAPSHOT_SIZE(header.count);
+
+  if (size < snapshotSize)
+  {
+    PWM_LOGERROR1("Error: Buffer too small, snapshot size = ", snapshotSize);
+    return 0;
+  }
+
+  for (uint8_t i = 0; i < header.count; i++)
+  {
+    // run() may be late, or the new period shorter
+    channels[i].phase %= channels[i].period;
+  }
+
+  header.magic            = PWM_SNAPSHOT_MAGIC;
+  header.version          = PWM_SNAPSHOT_VERSION;
+  header.microsResolution = USING_MICROS_RESOLUTION;
+  header.checksum         = snapshotChecksum(header, channels);
+
+  memcpy(buffer, &header, sizeof(header));
+  memcpy( (uint8_t*) buffer + sizeof(header), channels, header.count * sizeof(PWM_SnapshotChannel_t));
+
+  PWM_LOGINFO1("Saved channels : ", header.count);
+
+  return snapshotSize;
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_PWM_ISR::restoreSnapshot(const void* buffer, const size_t& size)
+{
+  PWM_SnapshotHeader_t  header;
+  PWM_SnapshotChannel_t channels[MAX_NUMBER_CHANNELS];
+
+  if ( (buffer == nullptr) || (size < sizeof(header)) )
+  {
+    PWM_LOGERROR("Error: Invalid snapshot");
+    return -1;
+  }
+
+  // The buffer may not be aligned
+  memcpy(&header, buffer, sizeof(header));
+
+  if ( (header.magic != PWM_SNAPSHOT_MAGIC) || (header.version != PWM_SNAPSHOT_VERSION) || 
+       (header.microsResolution != USING_MICROS_RESOLUTION) || (header.count > MAX_NUMBER_CHANNELS) || 
+       (size < PWM_SNAPSHOT_SIZE(header.count)) )
+  {
+    PWM_LOGERROR("Error: Invalid snapshot, or from another version or timebase");
+    return -1;
+  }
+
+  memcpy(channels, (const uint8_t*) buffer + sizeof(header), header.count * sizeof(PWM_SnapshotChannel_t));
+
+  if (snapshotChecksum(header, channels) != header.checksum)
+  {
+    PWM_LOGERROR("Error: Corrupted snapshot");
+    return -1;
+  }
+
+  // Check everything first, so that either all or none of the channels are restored
+  uint32_t channelMask = 0;
+
+  for (uint8_t i = 0; i < header.count; i++)
+  {
+    const PWM_SnapshotChannel_t& record = channels[i];
+
+    bool complementary = (record.flags & PWM_SNAPSHOT_COMPLEMENTARY);
+
+    if ( (record.channelNum >= MAX_NUMBER_CHANNELS) || (channelMask & (1UL << record.channelNum)) || 
+         (record.period == 0) || (record.onTime > record.period) || (record.phase >= record.period) || 
+         (record.pin >= PWM_MAX_PINS) || 
+         ( complementary && ( (record.pinB >= PWM_MAX_PINS) || (record.pinB == record.pin) || 
+                              (2 * record.deadTime >= record.period) ) ) )
+    {
+      PWM_LOGERROR("Error: Invalid channel in snapshot");
+      return -1;
+    }
+
+    channelMask |= (1UL << record.channelNum);
+  }
+
+  if (numChannels < 0)
+  {
+    init();
+  }
+
+  // Initialise all the pins in one pass, before any channel starts
+  for (uint8_t i = 0; i < header.count; i++)
+  {
+    pinMode(channels[i].pin, OUTPUT);
+
+    if (channels[i].flags & PWM_SNAPSHOT_COMPLEMENTARY)
+    {
+      pinMode(channels[i].pinB, OUTPUT);
+    }
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  if ( (channelMask & freeMask) != channelMask )
+  {
+    endStateWrite();
+
+    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+    portEXIT_CRITICAL(&PWM_Mux);
+
+    PWM_LOGERROR("Error: PWM channels of the snapshot already used");
+    return -1;
+  }
+
+  // Common start instant for all the channels, each one resuming from its phase
+  uint64_t startTime        = timeNow();
+  uint64_t coarseStartTime  = timeNowCoarse();
+
+  PWM_GPIO_Mask_t setMask   = 0;
+  PWM_GPIO_Mask_t clearMask = 0;
+
+  for (uint8_t i = 0; i < header.count; i++)
+  {
+    const PWM_SnapshotChannel_t& record = channels[i];
+
+    bool      exactFreq     = (record.flags & PWM_SNAPSHOT_EXACT);
+    bool      dithered      = (record.flags & PWM_SNAPSHOT_DITHERED);
+    bool      coarse        = (record.flags & PWM_SNAPSHOT_COARSE);
+    bool      enabled       = (header.enableMask & (1UL << record.channelNum));
+    uint64_t  channelStart  = coarse ? coarseStartTime : startTime;
+
+    // Right after boot, the time may still be shorter than the phase
+    uint32_t  phase         = (record.phase <= channelStart) ? record.phase : 0;
+
+    allocPWMChannel(record.pin, record.period, record.onTime, exactFreq, record.periodFrac, record.onTimeFrac, 
+                    nullptr, nullptr, channelStart - phase, record.channelNum);
+
+    volatile PWM_t& channel = PWM[record.channelNum];
+
+    channel.dithered        = dithered;
+    channel.onTimeFrac      = (exactFreq || dithered) ? record.onTimeFrac : 0;
+    channel.precision       = coarse ? PWM_PRECISION_COARSE : PWM_PRECISION_FINE;
+    channel.highPrecision   = PWM_LOOKAHEAD_AVAILABLE && (record.flags & PWM_SNAPSHOT_HIGH_PRECISION);
+    channel.stopLevel       = (record.flags & PWM_SNAPSHOT_STOP_HIGH) ? HIGH : LOW;
+
+    if (record.flags & PWM_SNAPSHOT_COMPLEMENTARY)
+    {
+      pinToChannel[record.pinB] = record.channelNum;
+
+      channel.complementary = true;
+      channel.pinB          = record.pinB;
+      channel.deadTime      = record.deadTime;
+
+      // Both outputs set by the next run(), from the phase
+      channel.pinHigh       = false;
+      clearMask            |= PWM_GPIO_MASK(record.pin) | PWM_GPIO_MASK(record.pinB);
+    }
+    else if (!enabled)
+    {
+      channel.pinHigh       = false;
+
+      if (channel.stopLevel)
+      {
+        setMask            |= PWM_GPIO_MASK(record.pin);
+      }
+      else
+      {
+        clearMask          |= PWM_GPIO_MASK(record.pin);
+      }
+    }
+    else if (phase < record.onTime)
+    {
+      setMask              |= PWM_GPIO_MASK(record.pin);
+    }
+    else
+    {
+      // The pulse of the current cycle is already over
+      channel.pinHigh       = false;
+      clearMask            |= PWM_GPIO_MASK(record.pin);
+    }
+  }
+
+  // All pins at once
+  PWM_writeGPIOMask(setMask, clearMask);
+
+  for (uint8_t i = 0; i < header.count; i++)
+  {
+    PWM[channels[i].channelNum].enabled = (header.enableMask & (1UL << channels[i].channelNum));
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  wakeTimer();
+
+  PWM_LOGINFO1("Restored channels : ", header.count);
+  PWM_LOGINFO1("Start_Time : ", startTime);
+
+  return header.count;
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_PWM_ISR::loadStaticChannels(const PWM_StaticChannel_t* table, const uint8_t& count)
+{
+  // A table not declared by PWM_STATIC_TABLE() is unchecked. A zero period would divide by 0 in nextCycle()
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if ( !table[i].valid || (table[i].period == 0) || (table[i].onTime > table[i].period) || 
+         (table[i].pin >= PWM_MAX_PINS) || (table[i].pinMask != PWM_GPIO_MASK(table[i].pin)) )
+    {
+      PWM_LOGERROR1("Error: Invalid static channel ", i);
+      return -1;
+    }
+  }
+
+  if (numChannels < 0)
+  {
+    init();
+  }
+
+  PWM_GPIO_Mask_t pinMask     = 0;
+  uint32_t        channelMask = (count < 32) ? ( (1UL << count) - 1 ) : 0xFFFFFFFF;
+
+  // Initialise all the pins in one pass, before any channel starts
+  for (uint8_t i = 0; i < count; i++)
+  {
+    pinMode(table[i].pin, OUTPUT);
+
+    pinMask |= table[i].pinMask;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
+
+  beginStateWrite();
+
+  if ( (channelMask & freeMask) != channelMask )
+  {
+    endStateWrite();
+
+    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+    portEXIT_CRITICAL(&PWM_Mux);
+
+    PWM_LOGERROR("Error: PWM channels of the table already used");
+    return -1;
+  }
+
+  // Common start instant for all the channels
+  uint64_t startTime = timeNow();
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    allocPWMChannel(table[i].pin, table[i].period, table[i].onTime, false, 0, 0, nullptr, nullptr, startTime, i);
+  }
+
+  // All pins HIGH at once
+  PWM_writeGPIOMask(pinMask, 0);
 
-#if CHANGING_PWM_END_OF_CYCLE
+  for (uint8_t i = 0; i < count; i++)
+  {
+    PWM[i].enabled = true;
+  }
 
-        // Only update whenever having newPeriod
-        if (PWM[channelNum].newPeriod != 0)
-        {
-          PWM[channelNum].period    = PWM[channelNum].newPeriod;
-          PWM[channelNum].newPeriod = 0;
+  endStateWrite();
 
-          PWM[channelNum].onTime  = PWM[channelNum].newOnTime;
-        }
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
 
-#endif
-      }
-    }
-  }
+  wakeTimer();
 
-  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
-  portEXIT_CRITICAL_ISR(&PWM_Mux);
-}
+  PWM_LOGINFO1("Static channels : ", count);
+  PWM_LOGINFO1("Start_Time : ", startTime);
 
+  return count;
+}
 
 ///////////////////////////////////////////////////
 
-// find the first available slot
-// return -1 if none found
-int ESP32_PWM_ISR::findFirstFreeSlot()
+uint32_t ESP32_PWM_ISR::snapshotChecksum(const PWM_SnapshotHeader_t& header, const PWM_SnapshotChannel_t* channels)
 {
-  // all slots are used
-  if (numChannels >= MAX_NUMBER_CHANNELS)
+  PWM_SnapshotHeader_t headerCopy = header;
+
+  headerCopy.checksum = 0;
+
+  // Word by word, both structs being made of whole 32-bit words
+  uint32_t hash = 2166136261UL;
+
+  const uint32_t* words = (const uint32_t*) &headerCopy;
+
+  for (size_t i = 0; i < sizeof(headerCopy) / 4; i++)
   {
-    return -1;
+    hash = (hash ^ words[i]) * 16777619UL;
   }
 
-  // return the first slot with no callbackStart (i.e. free)
-  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_CHANNELS; channelNum++)
+  words = (const uint32_t*) channels;
+
+  for (size_t i = 0; i < header.count * sizeof(PWM_SnapshotChannel_t) / 4; i++)
   {
-    if ( (PWM[channelNum].period == 0) && !PWM[channelNum].enabled )
-    {
-      return channelNum;
-    }
+    hash = (hash ^ words[i]) * 16777619UL;
   }
 
-  // no free slots found
-  return -1;
+  return hash;
 }
 
 ///////////////////////////////////////////////////
 
-int ESP32_PWM_ISR::setupPWMChannel(const uint32_t& pin, const uint32_t& period, const float& dutycycle,
-                                   void* cbStartFunc, void* cbStopFunc)
+bool ESP32_PWM_ISR::setHighPrecision(const uint8_t& channelNum, const bool& highPrecision)
 {
-  int channelNum;
+#if PWM_LOOKAHEAD_AVAILABLE
 
-  // Invalid input, such as period = 0, etc
-  if ( (period == 0) || (dutycycle < 0.0) || (dutycycle > 100.0) )
+  if ( (channelNum >= MAX_NUMBER_CHANNELS) || (PWM[channelNum].period == 0) || PWM[channelNum].complementary || 
+       (PWM[channelNum].precision == PWM_PRECISION_COARSE) || PWM[channelNum].servo )
   {
-    PWM_LOGERROR("Error: Invalid period or dutycycle");
-    return -1;
+    PWM_LOGERROR("Error: Invalid channelNum, or coarse, complementary or servo channel");
+    return false;
   }
 
-  if (numChannels < 0)
-  {
-    init();
-  }
+  // May have been changed by setCpuFrequencyMhz()
+  cyclesPerUs = getCpuFrequencyMhz();
 
-  channelNum = findFirstFreeSlot();
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
 
-  if (channelNum < 0)
+  beginStateWrite();
+
+  PWM[channelNum].highPrecision = highPrecision;
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
+
+  return true;
+
+#else
+
+  (void) channelNum;
+  (void) highPrecision;
+
+  PWM_LOGERROR("Error: Look-ahead needs USING_MICROS_RESOLUTION and no PWM_PIPELINED_ISR");
+  return false;
+
+#endif
+}
+
+///////////////////////////////////////////////////
+
+uint8_t ESP32_PWM_ISR::waitForEvent(const uint8_t& channelNum, const uint8_t& events, const TickType_t& timeout)
+{
+  if ( (channelNum >= MAX_NUMBER_CHANNELS) || (events == 0) )
   {
-    return -1;
+    return 0;
   }
 
+  TaskHandle_t  task        = xTaskGetCurrentTaskHandle();
+  bool          registered  = false;
+
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
   portENTER_CRITICAL(&PWM_Mux);
 
-  PWM[channelNum].pin           = pin;
-  PWM[channelNum].period        = period;
+  if ( PWM[channelNum].enabled && (PWM[channelNum].waitTask == nullptr) )
+  {
+    PWM[channelNum].waitTask    = task;
+    PWM[channelNum].waitEvents  = events | PWM_EVENT_STOPPED;
+    registered                  = true;
+  }
 
-  // Must be 0 for new PWM channel
-  PWM[channelNum].newPeriod     = 0;
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
 
-  PWM[channelNum].onTime        = ( period * dutycycle ) / 100;
+  if (!registered)
+  {
+    PWM_LOGERROR("Error: Channel disabled or already waited for");
+    return 0;
+  }
 
-  pinMode(pin, OUTPUT);
-  digitalWrite(pin, HIGH);
-  PWM[channelNum].pinHigh       = true;
+  // A steady channel has to be serviced again
+  wakeTimer();
 
-  PWM[channelNum].prevTime      = timeNow();
+  uint32_t event = 0;
 
-  PWM[channelNum].callbackStart = cbStartFunc;
-  PWM[channelNum].callbackStop  = cbStopFunc;
+  if (xTaskNotifyWait(0, 0xFFFFFFFF, &event, timeout) == pdTRUE)
+  {
+    return event;
+  }
 
+  // Timeout. Unregister, unless run() has notified meanwhile
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
-  portEXIT_CRITICAL(&PWM_Mux);
+  portENTER_CRITICAL(&PWM_Mux);
 
-  PWM_LOGINFO0("Channel : ");
-  PWM_LOGINFO0(channelNum);
-  PWM_LOGINFO0("\t    Period : ");
-  PWM_LOGINFO0(PWM[channelNum].period);
-  PWM_LOGINFO0("\t\tOnTime : ");
-  PWM_LOGINFO0(PWM[channelNum].onTime);
-  PWM_LOGINFO0("\tStart_Time : ");
-  PWM_LOGINFOLN0(PWM[channelNum].prevTime);
+  if (PWM[channelNum].waitTask == task)
+  {
+    PWM[channelNum].waitTask    = nullptr;
+    PWM[channelNum].waitEvents  = 0;
+    registered                  = false;
+  }
 
-  numChannels++;
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
 
-  PWM[channelNum].enabled      = true;
+  // Consume the late notification, not to wake the next wait
+  if ( registered && (xTaskNotifyWait(0, 0xFFFFFFFF, &event, 0) == pdTRUE) )
+  {
+    return event;
+  }
 
-  return channelNum;
+  return 0;
 }
 
 ///////////////////////////////////////////////////
 
-bool ESP32_PWM_ISR::modifyPWMChannel_Period(const uint8_t& channelNum, const uint32_t& pin, const uint32_t& period,
-                                            const float& dutycycle)
+int ESP32_PWM_ISR::setServo(const uint32_t& pin, const uint16_t& pulseUs, const uint16_t& minUs, const uint16_t& maxUs)
 {
-  // Invalid input, such as period = 0, etc
-  if ( (period == 0) || (dutycycle < 0.0) || (dutycycle > 100.0) )
-  {
-    PWM_LOGERROR("Error: Invalid period or dutycycle");
-    return false;
-  }
+#if USING_MICROS_RESOLUTION
 
-  if (channelNum > MAX_NUMBER_CHANNELS)
+  if ( (minUs == 0) || (minUs > maxUs) || (maxUs > PWM_SERVO_FRAME_US) )
   {
-    PWM_LOGERROR("Error: channelNum > MAX_NUMBER_CHANNELS");
-    return false;
+    PWM_LOGERROR("Error: Invalid servo limits");
+    return -1;
   }
 
-  if (PWM[channelNum].pin != pin)
+  if (numChannels < 0)
   {
-    PWM_LOGERROR("Error: channelNum and pin mismatched");
-    return false;
+    init();
   }
 
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+
+  int channelNum = -1;
+
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
   portENTER_CRITICAL(&PWM_Mux);
 
-#if CHANGING_PWM_END_OF_CYCLE
+  beginStateWrite();
 
-  PWM[channelNum].newPeriod     = period;
-  PWM[channelNum].newDutyCycle  = dutycycle;
-  PWM[channelNum].newOnTime     = ( period * dutycycle ) / 100;
+  // The least loaded lane
+  uint8_t laneNum = 0;
 
-  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
-  portEXIT_CRITICAL(&PWM_Mux);
+  for (uint8_t i = 1; i < PWM_SERVO_LANES; i++)
+  {
+    if (servoLanes[i].load < servoLanes[laneNum].load)
+    {
+      laneNum = i;
+    }
+  }
 
-  PWM_LOGINFO0("Channel : ");
-  PWM_LOGINFO0(channelNum);
-  PWM_LOGINFO0("\t    Period : ");
-  PWM_LOGINFO0(period);
-  PWM_LOGINFO0("\t\tOnTime : ");
-  PWM_LOGINFO0(PWM[channelNum].newOnTime);
-  PWM_LOGINFO0("\tStart_Time : ");
-  PWM_LOGINFOLN0(PWM[channelNum].prevTime);
+  volatile PWM_ServoLane_t& lane = servoLanes[laneNum];
 
-#else
+  if (lane.load + maxUs <= PWM_SERVO_FRAME_US)
+  {
+    uint64_t startTime = timeNow();
 
-  PWM[channelNum].period        = period;
-  PWM[channelNum].onTime        = ( period * dutycycle ) / 100;
+    channelNum = allocPWMChannel(pin, PWM_SERVO_FRAME_US, 0, false, 0, 0, nullptr, nullptr, startTime);
+  
+    if (channelNum >= 0)
+    {
+      PWM[channelNum].servo       = true;
+      PWM[channelNum].servoLane   = laneNum;
+      PWM[channelNum].servoPulse  = pulseUs;
+      PWM[channelNum].servoTrim   = 0;
+      PWM[channelNum].servoMin    = minUs;
+      PWM[channelNum].servoMax    = maxUs;
+      PWM[channelNum].onTime      = servoOnTime(channelNum);
+      PWM[channelNum].baseOnTime  = PWM[channelNum].onTime;
+
+      // LOW until its turn in the lane
+      PWM[channelNum].pinHigh     = false;
+      PWM[channelNum].pulsed      = false;
+
+      // An empty lane starts a new frame at the next run()
+      if (lane.mask == 0)
+      {
+        lane.channelNum = -1;
+        lane.nextEdge   = startTime;
+      }
 
-  digitalWrite(pin, HIGH);
-  PWM[channelNum].pinHigh       = true;
+      lane.mask |= (1UL << channelNum);
+      lane.load += maxUs;
+
+      PWM[channelNum].enabled     = true;
+    }
+  }
 
-  PWM[channelNum].prevTime      = timeNow();
+  endStateWrite();
 
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
   portEXIT_CRITICAL(&PWM_Mux);
 
-  PWM_LOGINFO0("Channel : ");
-  PWM_LOGINFO0(channelNum);
-  PWM_LOGINFO0("\t    Period : ");
-  PWM_LOGINFO0(PWM[channelNum].period);
-  PWM_LOGINFO0("\t\tOnTime : ");
-  PWM_LOGINFO0(PWM[channelNum].onTime);
-  PWM_LOGINFO0("\tStart_Time : ");
-  PWM_LOGINFOLN0(PWM[channelNum].prevTime);
+  wakeTimer();
 
-#endif
+  if (channelNum < 0)
+  {
+    PWM_LOGERROR("Error: No free PWM channel or servo lane");
+    return -1;
+  }
 
-  return true;
-}
+  PWM_LOGINFO_LINE("Servo : ", channelNum,
+                   "\t    Lane : ", laneNum,
+                   "\t\tPulse : ", PWM[channelNum].onTime);
+
+  return channelNum;
+
+#else
 
+  (void) pin;
+  (void) pulseUs;
+  (void) minUs;
+  (void) maxUs;
+
+  PWM_LOGERROR("Error: Servo channels need USING_MICROS_RESOLUTION");
+  return -1;
+
+#endif
+}
 
 ///////////////////////////////////////////////////
 
-void ESP32_PWM_ISR::deleteChannel(const uint8_t& channelNum)
+bool ESP32_PWM_ISR::setServoPulse(const uint8_t& channelNum, const uint16_t& pulseUs)
 {
-  // nothing to delete if no timers are in use
-  if ( (channelNum >= MAX_NUMBER_CHANNELS)  || (numChannels == 0) )
+  if (!isServo(channelNum))
   {
-    return;
+    PWM_LOGERROR("Error: Invalid servo channelNum");
+    return false;
   }
 
-  // don't decrease the number of timers if the specified slot is already empty (zero period, invalid)
-  if ( (PWM[channelNum].pin != INVALID_ESP32_PIN) && (PWM[channelNum].period != 0) )
-  {
-    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
-    portENTER_CRITICAL(&PWM_Mux);
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
 
-    memset((void*) &PWM[channelNum], 0, sizeof (PWM_t));
+  beginStateWrite();
 
-    PWM[channelNum].pin = INVALID_ESP32_PIN;
+  // The pulse in progress, if any, keeps its width, its end being already scheduled
+  PWM[channelNum].servoPulse  = pulseUs;
+  PWM[channelNum].onTime      = servoOnTime(channelNum);
+  PWM[channelNum].baseOnTime  = PWM[channelNum].onTime;
 
-    // update number of timers
-    numChannels--;
+  endStateWrite();
 
-    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
-    portEXIT_CRITICAL(&PWM_Mux);
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
 
-  }
+  return true;
 }
 
 ///////////////////////////////////////////////////
 
-// function contributed by code@rowansimms.com
-void ESP32_PWM_ISR::restartChannel(const uint8_t& channelNum)
+bool ESP32_PWM_ISR::setServoTrim(const uint8_t& channelNum, const int16_t& trimUs)
 {
-  if (channelNum >= MAX_NUMBER_CHANNELS)
+  if (!isServo(channelNum))
   {
-    return;
+    PWM_LOGERROR("Error: Invalid servo channelNum");
+    return false;
   }
 
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
   portENTER_CRITICAL(&PWM_Mux);
 
-  PWM[channelNum].prevTime = timeNow();
+  beginStateWrite();
+
+  PWM[channelNum].servoTrim   = trimUs;
+  PWM[channelNum].onTime      = servoOnTime(channelNum);
+  PWM[channelNum].baseOnTime  = PWM[channelNum].onTime;
+
+  endStateWrite();
 
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
   portEXIT_CRITICAL(&PWM_Mux);
+
+  return true;
 }
 
 ///////////////////////////////////////////////////
 
-bool ESP32_PWM_ISR::isEnabled(const uint8_t& channelNum)
+bool ESP32_PWM_ISR::setServoLimits(const uint8_t& channelNum, const uint16_t& minUs, const uint16_t& maxUs)
 {
-  if (channelNum >= MAX_NUMBER_CHANNELS)
+  if ( !isServo(channelNum) || (minUs == 0) || (minUs > maxUs) )
   {
+    PWM_LOGERROR("Error: Invalid servo channelNum or limits");
     return false;
   }
 
-  return PWM[channelNum].enabled;
-}
+  bool changed = false;
 
-///////////////////////////////////////////////////
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&PWM_Mux);
 
-void ESP32_PWM_ISR::enable(const uint8_t& channelNum)
-{
-  if (channelNum >= MAX_NUMBER_CHANNELS)
+  beginStateWrite();
+
+  volatile PWM_ServoLane_t& lane = servoLanes[PWM[channelNum].servoLane];
+
+  uint32_t load = lane.load - PWM[channelNum].servoMax + maxUs;
+
+  if (load <= PWM_SERVO_FRAME_US)
   {
-    return;
+    lane.load                   = load;
+    PWM[channelNum].servoMin    = minUs;
+    PWM[channelNum].servoMax    = maxUs;
+    PWM[channelNum].onTime      = servoOnTime(channelNum);
+    PWM[channelNum].baseOnTime  = PWM[channelNum].onTime;
+    changed                     = true;
   }
 
-  PWM[channelNum].enabled = true;
-}
+  endStateWrite();
 
-///////////////////////////////////////////////////
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&PWM_Mux);
 
-void ESP32_PWM_ISR::disable(const uint8_t& channelNum)
-{
-  if (channelNum >= MAX_NUMBER_CHANNELS)
+  if (!changed)
   {
-    return;
+    PWM_LOGERROR("Error: No room in the servo lane");
   }
 
-  PWM[channelNum].enabled = false;
+  return changed;
 }
 
 ///////////////////////////////////////////////////
 
-void ESP32_PWM_ISR::enableAll()
+bool ESP32_PWM_ISR::setRamp(const uint8_t& channelNum, const float& cruiseFreq, const float& accel, const float& decel,
+                            const uint32_t& steps)
 {
-  // Enable all timers with a callbackStart assigned (used)
+#if USING_MICROS_RESOLUTION
 
-  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
-  portENTER_CRITICAL(&PWM_Mux);
+  if ( (channelNum >= MAX_NUMBER_CHANNELS) || (PWM[channelNum].period == 0) || PWM[channelNum].complementary || 
+       PWM[channelNum].servo || (PWM[channelNum].precision == PWM_PRECISION_COARSE) )
+  {
+    PWM_LOGERROR("Error: Invalid channelNum, or coarse, complementary or servo channel");
+    return false;
+  }
 
-  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_CHANNELS; channelNum++)
+  if ( (cruiseFreq <= 0.0) || (cruiseFreq > PWM_RAMP_MAX_FREQUENCY) || (accel < 1.0) || (decel < 1.0) || (steps == 0) )
   {
-    if (PWM[channelNum].period != 0)
-    {
-      PWM[channelNum].enabled = true;
-    }
+    PWM_LOGERROR("Error: Invalid ramp");
+    return false;
   }
 
-  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
-  portEXIT_CRITICAL(&PWM_Mux);
-}
+  // Steps to reach cruiseFreq, and to stop from it. If more than steps, a triangular profile, peaking at the step 
+  // where both meet
+  float decelSteps = ( cruiseFreq * cruiseFreq ) / ( 2 * decel );
 
-///////////////////////////////////////////////////
+  if ( ( ( cruiseFreq * cruiseFreq ) / ( 2 * accel ) ) + decelSteps > steps )
+  {
+    decelSteps = ( (float) steps * accel ) / ( accel + decel );
+  }
 
-void ESP32_PWM_ISR::disableAll()
-{
-  // Disable all timers with a callbackStart assigned (used)
+  // Periods in 1 / 256 us. The first one is corrected by 0.676, as in AVR446
+  uint32_t minPeriod    = ( 256 * 1000000.0f ) / cruiseFreq;
+  float    firstPeriod  = 0.676f * 256 * 1000000.0f * sqrtf(2.0f / accel);
+  
+  uint32_t rampPeriod   = (firstPeriod < minPeriod) ? minPeriod : 
+                          ( (firstPeriod > 0xFFFFFFFF / 4) ? 0xFFFFFFFF / 4 : (uint32_t) firstPeriod );
 
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
   portENTER_CRITICAL(&PWM_Mux);
 
-  for (uint8_t channelNum = 0; channelNum < MAX_NUMBER_CHANNELS; channelNum++)
+  beginStateWrite();
+
+  volatile PWM_t& channel = PWM[channelNum];
+
+  uint64_t duty           = ( (uint64_t) channel.onTime << 16 ) / channel.period;
+
+  channel.rampDuty        = (duty > 0xFFFF) ? 0xFFFF : duty;
+  channel.rampSteps       = steps;
+  channel.rampDecelSteps  = (decelSteps < 1) ? 1 : (uint32_t) (decelSteps + 0.5f);
+  channel.rampN           = 1;
+  channel.rampRest        = 0;
+  channel.rampPeriod      = rampPeriod;
+  channel.rampMinPeriod   = minPeriod;
+  channel.ramping         = true;
+
+  // Not to be overridden by a pending change at the end of the cycle
+  channel.newPeriod       = 0;
+
+  // Enabling cancels a pending disable. A pending delete is never cancelled
+  if (channel.pendingOp == PWM_OP_DISABLE)
   {
-    if (PWM[channelNum].period != 0)
-    {
-      PWM[channelNum].enabled = false;
-    }
+    channel.pendingOp = PWM_OP_NONE;
+  }
+
+  if (!channel.enabled)
+  {
+    // The first step starts now, HIGH at next run()
+    startRampStep(channelNum);
+
+    channel.period    = channel.basePeriod;
+    channel.onTime    = channel.baseOnTime;
+    channel.periodAcc = 0;
+    channel.onTimeAcc = 0;
+    channel.pinHigh   = false;
+    channel.pulsed    = false;
+    channel.prevTime  = timeNow();
+    channel.enabled   = true;
   }
 
+  endStateWrite();
+
   // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
   portEXIT_CRITICAL(&PWM_Mux);
 
+  wakeTimer();
+
+  return true;
+
+#else
+
+  (void) channelNum;
+  (void) cruiseFreq;
+  (void) accel;
+  (void) decel;
+  (void) steps;
+
+  PWM_LOGERROR("Error: Ramps need USING_MICROS_RESOLUTION");
+  return false;
+
+#endif
 }
 
 ///////////////////////////////////////////////////
 
-void ESP32_PWM_ISR::toggle(const uint8_t& channelNum)
+int IRAM_ATTR ESP32_PWM_ISR::firePulseFromISR(const uint32_t& pin, const uint32_t& delay, const uint32_t& width)
 {
-  if (channelNum >= MAX_NUMBER_CHANNELS)
+  // init() is not callable from ISR
+  if ( (width == 0) || (numChannels < 0) )
   {
-    return;
+    return -1;
   }
 
-  PWM[channelNum].enabled = !PWM[channelNum].enabled;
-}
+  uint64_t pulseTime = timeNow() + delay;
 
-///////////////////////////////////////////////////
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portENTER_CRITICAL_ISR(&PWM_Mux);
 
-int8_t ESP32_PWM_ISR::getnumChannels()
-{
-  return numChannels;
+  beginStateWrite();
+
+  int channelNum = (freeMask == 0) ? -1 : __builtin_ctz(freeMask);
+
+  if (channelNum >= 0)
+  {
+    freeMask &= ~(1UL << channelNum);
+    numChannels++;
+
+    // A free slot is all 0, see stopChannel(). Not in the pin-to-channel lookup table
+    PWM[channelNum].pin           = pin;
+    PWM[channelNum].prevTime      = pulseTime;
+    PWM[channelNum].onTime        = width;
+    PWM[channelNum].period        = delay + width;
+    PWM[channelNum].oneShot       = true;
+    PWM[channelNum].highPrecision = PWM_LOOKAHEAD_AVAILABLE;
+    PWM[channelNum].enabled       = true;
+
+    wakeTimerFromISR();
+  }
+
+  endStateWrite();
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&PWM_Mux);
+
+  return channelNum;
 }
 
 #endif    // PWM_ISR_GENERIC_IMPL_H
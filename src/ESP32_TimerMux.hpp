@@ -0,0 +1,204 @@
+/****************************************************************************************************************************
+  ESP32_TimerMux.hpp
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+  
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers. 
+  The timer counters can be configured to count up or down and support automatic reload and software reload. 
+  They can also generate alarms when they reach a specific value, defined by the software. 
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+
+  Version: 1.3.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      20/09/2021 Initial coding for ESP32, ESP32_S2, ESP32_C3 boards with ESP32 core v2.0.0+
+  1.0.1   K Hoang      21/09/2021 Fix bug. Ading PWM end-of-duty-cycle callback function. Improve examples
+  1.1.0   K Hoang      06/11/2021 Add functions to modify PWM settings on-the-fly
+  1.1.1   K Hoang      09/11/2021 Fix examples to not use GPIO1/TX0 for core v2.0.1+
+  1.2.0   K Hoang      29/01/2022 Fix multiple-definitions linker error. Improve accuracy. Fix bug
+  1.2.1   K Hoang      30/01/2022 DutyCycle to be updated at the end current PWM period
+  1.2.2   K Hoang      01/02/2022 Use float for DutyCycle and Freq, uint32_t for period. Optimize code
+  1.3.0   K Hoang      12/02/2022 Add support to new ESP32-S3
+  1.3.1   K Hoang      04/03/2022 Fix `DutyCycle` and `New Period` display bugs. Display warning only when debug level > 3
+  1.3.2   K Hoang      09/05/2022 Remove crashing PIN_D24 from examples
+  1.3.3   K Hoang      16/06/2022 Add support to new Adafruit boards
+*****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef ESP32_TIMER_MUX_HPP
+#define ESP32_TIMER_MUX_HPP
+
+#include "ESP32_PWM_ISR.hpp"
+
+// Many virtual one-shot and periodic alarms on one hardware timer, e.g. for the ESP32_C3 with only 2 timers.
+// The timer counts freely from begin(), as the timebase of all alarms. Their deadlines, in timer ticks, are kept
+// in a min-heap, and the hardware alarm is always set to the earliest one. The PWM engine is a client as any other :
+//
+//   ESP32Timer     ITimer(1, 2);
+//   ESP32_TimerMux TimerMux;
+//   bool IRAM_ATTR TimerHandler(void * timerNo) { TimerMux.run(); return true; }
+//   ...
+//   TimerMux.begin(&ITimer, TimerHandler);
+//   TimerMux.setInterval(HW_TIMER_INTERVAL_US, ESP32_TimerMux::runPWM, &ISR_PWM);
+//   TimerMux.setInterval(1000, ControlLoop);
+
+#if !defined(MAX_NUMBER_TIMER_MUX_ALARMS)
+  #define MAX_NUMBER_TIMER_MUX_ALARMS     16
+#elif ( (MAX_NUMBER_TIMER_MUX_ALARMS < 1) || (MAX_NUMBER_TIMER_MUX_ALARMS > 64) )
+  #error MAX_NUMBER_TIMER_MUX_ALARMS must be from 1 to 64
+#endif
+
+// Shortest distance from the counter to the alarm being set. Must cover reading the counter and writing the alarm, 
+// with the interrupts disabled, else the counter could pass the alarm meanwhile, and the alarm never come.
+// An alarm due sooner comes up to that much late
+#if !defined(TIMER_MUX_MIN_DELAY_NS)
+  #define TIMER_MUX_MIN_DELAY_NS          1000
+#endif
+
+class ESP32_TimerMux
+{
+  public:
+
+    // constructor
+    ESP32_TimerMux();
+
+    // Start the timer counting freely, its ISR handler calling run() on each interrupt, e.g.
+    // bool IRAM_ATTR TimerHandler(void * timerNo) { TimerMux.run(); return true; }
+    // The timer is not to be used by anything else
+    bool begin(ESP32TimerInterrupt* timer, esp32_timer_callback handler);
+
+    // To be called from the ISR handler of the timer only. Calls all the alarms due, without holding any lock,
+    // then sets the hardware alarm to the next deadline
+    void IRAM_ATTR run();
+
+    //////////////////////////////////////////////////////////////////
+
+    // callback(arg) every period ticks of the timer, the first one delay ticks from now. period = 0 for a one-shot.
+    // The deadlines of a periodic alarm are kept on the grid of its first one, without drift.
+    // Return the alarmNum if OK, -1 if error
+    int setAlarmTicks(const uint64_t& delay, const uint64_t& period, timer_callback_p callback, void* arg = nullptr);
+
+    // callback(arg) every interval us, the first one interval us from now. Return the alarmNum if OK, -1 if error
+    int setInterval(const uint32_t& interval, timer_callback_p callback, void* arg = nullptr)
+    {
+      uint64_t ticks = ticksFromUs(interval);
+      
+      return setAlarmTicks(ticks, ticks, callback, arg);
+    }
+
+    // callback(arg) once, delay us from now. The alarm is freed just before the callback, which may set a new one.
+    // Return the alarmNum if OK, -1 if error
+    int setTimeout(const uint32_t& delay, timer_callback_p callback, void* arg = nullptr)
+    {
+      return setAlarmTicks(ticksFromUs(delay), 0, callback, arg);
+    }
+
+    // An alarm already due may still be called once, by the other core
+    bool deleteAlarm(const uint8_t& alarmNum);
+
+    bool isEnabled(const uint8_t& alarmNum)
+    {
+      return (alarmNum < MAX_NUMBER_TIMER_MUX_ALARMS) && (alarms[alarmNum].callback != nullptr);
+    }
+
+    // To use the PWM engine as a client, with &ISR_PWM as arg
+    static void IRAM_ATTR runPWM(void * pwm)
+    {
+      ( (ESP32_PWM_ISR *) pwm)->run();
+    }
+
+    // returns the number of used alarms
+    int8_t getnumAlarms()
+    {
+      return numAlarms;
+    }
+
+    // returns the number of available alarms
+    uint8_t getNumAvailableAlarms()
+    {
+      return MAX_NUMBER_TIMER_MUX_ALARMS - numAlarms;
+    }
+    
+    // Latest call of an alarm after its deadline, in ns, since begin()
+    uint32_t getMaxLatenessNs()
+    {
+      return ( (uint64_t) maxLateTicks * divider * 1000 ) / (TIMER_BASE_CLK / 1000000);
+    }
+
+    // Number of calls of the periodic alarms skipped since begin(), because run() was later than a whole period
+    uint32_t getOverruns()
+    {
+      return overruns;
+    }
+
+  private:
+
+    uint64_t ticksFromUs(const uint32_t& us)
+    {
+      return timerTicksFromUs(us, divider);
+    }
+
+    // find the first available slot. Must be called with TimerMux_Mux held
+    int findFirstFreeSlot();
+
+    // Set the hardware alarm to the earliest deadline, now the counter. Must be called with TimerMux_Mux held
+    void IRAM_ATTR setNextAlarm(const uint64_t& now);
+
+    // Min-heap of the alarmNums, by deadline. Must be called with TimerMux_Mux held
+    void IRAM_ATTR heapPush(const uint8_t& alarmNum);
+    void IRAM_ATTR heapRemove(const uint8_t& heapPos);
+    void IRAM_ATTR siftUp(uint8_t heapPos);
+    void IRAM_ATTR siftDown(uint8_t heapPos);
+
+    void IRAM_ATTR heapSet(const uint8_t& heapPos, const uint8_t& alarmNum)
+    {
+      heap[heapPos]                 = alarmNum;
+      alarms[alarmNum].heapPos      = heapPos;
+    }
+
+    typedef struct
+    {
+      uint64_t          deadline;           // in ticks of the timer counter
+      uint64_t          period;             // in ticks, 0 for a one-shot
+      
+      timer_callback_p  callback;           // nullptr if slot is free
+      void*             arg;
+      
+      uint8_t           heapPos;
+    } TimerMux_Alarm_t;
+
+    TimerMux_Alarm_t      alarms[MAX_NUMBER_TIMER_MUX_ALARMS];
+    
+    uint8_t               heap[MAX_NUMBER_TIMER_MUX_ALARMS];
+    uint8_t               heapSize;
+
+    ESP32TimerInterrupt*  timer;
+    uint32_t              divider;
+    uint32_t              minDelayTicks;
+
+    // actual number of alarms in use
+    int8_t                numAlarms;
+    
+    volatile uint32_t     maxLateTicks;
+    volatile uint32_t     overruns;
+
+    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+    portMUX_TYPE TimerMux_Mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif    // ESP32_TIMER_MUX_HPP
@@ -0,0 +1,382 @@
+/****************************************************************************************************************************
+  ESP32_TimerMux_Impl.h
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+  
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers. 
+  The timer counters can be configured to count up or down and support automatic reload and software reload. 
+  They can also generate alarms when they reach a specific value, defined by the software. 
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+
+  Version: 1.3.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      20/09/2021 Initial coding for ESP32, ESP32_S2, ESP32_C3 boards with ESP32 core v2.0.0+
+  1.0.1   K Hoang      21/09/2021 Fix bug. Ading PWM end-of-duty-cycle callback function. Improve examples
+  1.1.0   K Hoang      06/11/2021 Add functions to modify PWM settings on-the-fly
+  1.1.1   K Hoang      09/11/2021 Fix examples to not use GPIO1/TX0 for core v2.0.1+
+  1.2.0   K Hoang      29/01/2022 Fix multiple-definitions linker error. Improve accuracy. Fix bug
+  1.2.1   K Hoang      30/01/2022 DutyCycle to be updated at the end current PWM period
+  1.2.2   K Hoang      01/02/2022 Use float for DutyCycle and Freq, uint32_t for period. Optimize code
+  1.3.0   K Hoang      12/02/2022 Add support to new ESP32-S3
+  1.3.1   K Hoang      04/03/2022 Fix `DutyCycle` and `New Period` display bugs. Display warning only when debug level > 3
+  1.3.2   K Hoang      09/05/2022 Remove crashing PIN_D24 from examples
+  1.3.3   K Hoang      16/06/2022 Add support to new Adafruit boards
+*****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef ESP32_TIMER_MUX_IMPL_H
+#define ESP32_TIMER_MUX_IMPL_H
+
+///////////////////////////////////////////////////
+
+ESP32_TimerMux::ESP32_TimerMux()
+  : heapSize (0), timer (nullptr), divider (TIMER_DIVIDER), minDelayTicks (1), numAlarms (0), maxLateTicks (0), 
+    overruns (0)
+{
+  for (uint8_t alarmNum = 0; alarmNum < MAX_NUMBER_TIMER_MUX_ALARMS; alarmNum++)
+  {
+    alarms[alarmNum].callback = nullptr;
+  }
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_TimerMux::begin(ESP32TimerInterrupt* timer, esp32_timer_callback handler)
+{
+  if ( (timer == nullptr) || (handler == nullptr) )
+  {
+    PWM_LOGERROR("Error: Invalid timer or handler");
+    return false;
+  }
+  
+  if (!timer->attachInterruptFreeRunning(handler))
+  {
+    return false;
+  }
+  
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&TimerMux_Mux);
+
+  this->timer   = timer;
+  divider       = timer->getDivider();
+  minDelayTicks = timerTicksFromNs(TIMER_MUX_MIN_DELAY_NS, divider);
+  
+  if (minDelayTicks == 0)
+  {
+    minDelayTicks = 1;
+  }
+  
+  // The deadlines of the alarms set before are from another timebase
+  for (uint8_t alarmNum = 0; alarmNum < MAX_NUMBER_TIMER_MUX_ALARMS; alarmNum++)
+  {
+    alarms[alarmNum].callback = nullptr;
+  }
+  
+  heapSize      = 0;
+  numAlarms     = 0;
+  maxLateTicks  = 0;
+  overruns      = 0;
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&TimerMux_Mux);
+  
+  PWM_LOGINFO3("TimerMux: divider =", divider, ", minDelayTicks =", minDelayTicks);
+
+  return true;
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_TimerMux::run()
+{
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portENTER_CRITICAL_ISR(&TimerMux_Mux);
+  
+  if (timer == nullptr)
+  {
+    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+    portEXIT_CRITICAL_ISR(&TimerMux_Mux);
+    
+    return;
+  }
+
+  uint64_t now = timer->getCounterFromISR();
+
+  while ( (heapSize > 0) && (alarms[heap[0]].deadline <= now) )
+  {
+    TimerMux_Alarm_t& alarm = alarms[heap[0]];
+    
+    uint64_t late = now - alarm.deadline;
+    
+    if (late > maxLateTicks)
+    {
+      maxLateTicks = (late > 0xFFFFFFFF) ? 0xFFFFFFFF : late;
+    }
+    
+    // Copied, as the slot may be freed or reused by the other core while the callback runs
+    timer_callback_p  callback  = alarm.callback;
+    void*             arg       = alarm.arg;
+
+    if (alarm.period != 0)
+    {
+      // Next deadline on the same grid. The calls missed as a whole are skipped, not fired back-to-back
+      alarm.deadline += alarm.period;
+      
+      while (alarm.deadline <= now)
+      {
+        alarm.deadline += alarm.period;
+        overruns++;
+      }
+      
+      siftDown(0);
+    }
+    else
+    {
+      heapRemove(0);
+      
+      alarm.callback = nullptr;
+      numAlarms--;
+    }
+
+    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+    portEXIT_CRITICAL_ISR(&TimerMux_Mux);
+
+    // Without the lock, so that the callback may set or delete alarms, or take the locks of other engines
+    callback(arg);
+
+    // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+    portENTER_CRITICAL_ISR(&TimerMux_Mux);
+
+    now = timer->getCounterFromISR();
+  }
+  
+  setNextAlarm(now);
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during ISR
+  portEXIT_CRITICAL_ISR(&TimerMux_Mux);
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_TimerMux::setNextAlarm(const uint64_t& now)
+{
+  if (heapSize == 0)
+  {
+    timer->pauseAlarmFromISR();
+    
+    return;
+  }
+  
+  uint64_t alarmValue = alarms[heap[0]].deadline;
+  
+  if (alarmValue < now + minDelayTicks)
+  {
+    alarmValue = now + minDelayTicks;
+  }
+  
+  timer->setAlarmFromISR(alarmValue);
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_TimerMux::setAlarmTicks(const uint64_t& delay, const uint64_t& period, timer_callback_p callback, void* arg)
+{
+  if (timer == nullptr)
+  {
+    PWM_LOGERROR("Error: TimerMux not started, call begin()");
+    return -1;
+  }
+  
+  if (callback == nullptr)
+  {
+    PWM_LOGERROR("Error: Invalid callback");
+    return -1;
+  }
+  
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&TimerMux_Mux);
+
+  int alarmNum = findFirstFreeSlot();
+
+  if (alarmNum >= 0)
+  {
+    uint64_t now = timer->getCounterFromISR();
+    
+    alarms[alarmNum].deadline = now + delay;
+    alarms[alarmNum].period   = period;
+    alarms[alarmNum].callback = callback;
+    alarms[alarmNum].arg      = arg;
+    
+    heapPush(alarmNum);
+    numAlarms++;
+    
+    // Earlier than the hardware alarm set
+    if (heap[0] == alarmNum)
+    {
+      setNextAlarm(now);
+    }
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&TimerMux_Mux);
+  
+  if (alarmNum < 0)
+  {
+    PWM_LOGERROR("Error: No more alarms");
+  }
+  else
+  {
+    PWM_LOGINFO3("Alarm : ", alarmNum, ", period (ticks) : ", (uint32_t) period);
+  }
+
+  return alarmNum;
+}
+
+///////////////////////////////////////////////////
+
+bool ESP32_TimerMux::deleteAlarm(const uint8_t& alarmNum)
+{
+  if (alarmNum >= MAX_NUMBER_TIMER_MUX_ALARMS)
+  {
+    PWM_LOGERROR("Error: alarmNum >= MAX_NUMBER_TIMER_MUX_ALARMS");
+    return false;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portENTER_CRITICAL(&TimerMux_Mux);
+
+  bool used = (alarms[alarmNum].callback != nullptr);
+
+  if (used)
+  {
+    // The hardware alarm may still come for it, and only sets the next one
+    heapRemove(alarms[alarmNum].heapPos);
+    
+    alarms[alarmNum].callback = nullptr;
+    numAlarms--;
+  }
+
+  // ESP32 is a multi core / multi processing chip. It is mandatory to disable task switches during modifying shared vars
+  portEXIT_CRITICAL(&TimerMux_Mux);
+
+  return used;
+}
+
+///////////////////////////////////////////////////
+
+int ESP32_TimerMux::findFirstFreeSlot()
+{
+  for (uint8_t alarmNum = 0; alarmNum < MAX_NUMBER_TIMER_MUX_ALARMS; alarmNum++)
+  {
+    if (alarms[alarmNum].callback == nullptr)
+    {
+      return alarmNum;
+    }
+  }
+
+  // all slots are used
+  return -1;
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_TimerMux::heapPush(const uint8_t& alarmNum)
+{
+  heapSet(heapSize, alarmNum);
+  
+  siftUp(heapSize++);
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_TimerMux::heapRemove(const uint8_t& heapPos)
+{
+  heapSize--;
+  
+  if (heapPos == heapSize)
+  {
+    return;
+  }
+  
+  // The last one takes its place, then moves either way
+  uint8_t alarmNum = heap[heapSize];
+  
+  heapSet(heapPos, alarmNum);
+  
+  siftUp(heapPos);
+  siftDown(alarms[alarmNum].heapPos);
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_TimerMux::siftUp(uint8_t heapPos)
+{
+  uint8_t alarmNum = heap[heapPos];
+
+  while (heapPos > 0)
+  {
+    uint8_t parent = (heapPos - 1) / 2;
+    
+    if (alarms[heap[parent]].deadline <= alarms[alarmNum].deadline)
+    {
+      break;
+    }
+    
+    heapSet(heapPos, heap[parent]);
+    heapPos = parent;
+  }
+  
+  heapSet(heapPos, alarmNum);
+}
+
+///////////////////////////////////////////////////
+
+void IRAM_ATTR ESP32_TimerMux::siftDown(uint8_t heapPos)
+{
+  uint8_t alarmNum = heap[heapPos];
+
+  while (true)
+  {
+    uint8_t child = 2 * heapPos + 1;
+    
+    if (child >= heapSize)
+    {
+      break;
+    }
+    
+    if ( (child + 1 < heapSize) && (alarms[heap[child + 1]].deadline < alarms[heap[child]].deadline) )
+    {
+      child++;
+    }
+    
+    if (alarms[alarmNum].deadline <= alarms[heap[child]].deadline)
+    {
+      break;
+    }
+    
+    heapSet(heapPos, heap[child]);
+    heapPos = child;
+  }
+  
+  heapSet(heapPos, alarmNum);
+}
+
+///////////////////////////////////////////////////
+
+#endif    // ESP32_TIMER_MUX_IMPL_H
@@ -0,0 +1,170 @@
+/****************************************************************************************************************************
+  PWM_Brightness.h
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers.
+  The timer counters can be configured to count up or down and support automatic reload and software reload.
+  They can also generate alarms when they reach a specific value, defined by the software.
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+
+  Version: 1.3.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      20/09/2021 Initial coding for ESP32, ESP32_S2, ESP32_C3 boards with ESP32 core v2.0.0+
+  1.0.1   K Hoang      21/09/2021 Fix bug. Ading PWM end-of-duty-cycle callback function. Improve examples
+  1.1.0   K Hoang      06/11/2021 Add functions to modify PWM settings on-the-fly
+  1.1.1   K Hoang      09/11/2021 Fix examples to not use GPIO1/TX0 for core v2.0.1+
+  1.2.0   K Hoang      29/01/2022 Fix multiple-definitions linker error. Improve accuracy. Fix bug
+  1.2.1   K Hoang      30/01/2022 DutyCycle to be updated at the end current PWM period
+  1.2.2   K Hoang      01/02/2022 Use float for DutyCycle and Freq, uint32_t for period. Optimize code
+  1.3.0   K Hoang      12/02/2022 Add support to new ESP32-S3
+  1.3.1   K Hoang      04/03/2022 Fix `DutyCycle` and `New Period` display bugs. Display warning only when debug level > 3
+  1.3.2   K Hoang      09/05/2022 Remove crashing PIN_D24 from examples
+  1.3.3   K Hoang      16/06/2022 Add support to new Adafruit boards
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef PWM_BRIGHTNESS_H
+#define PWM_BRIGHTNESS_H
+
+// Perceptual brightness to dutycycle lookup tables, generated at compile time.
+// A brightness from 0 to ( 2^PWM_BRIGHTNESS_BITS - 1 ) is mapped to a dutycycle fraction from 0 to 65535 (100%),
+// so that modifyBrightness() is a single table read, without any float maths.
+// A table is only stored in flash if used, 2 bytes per entry : 512 bytes for 8 bits, 2KB for 10 bits, 8KB for 12 bits
+
+#define PWM_CURVE_LINEAR              0     // no correction
+#define PWM_CURVE_GAMMA               1     // dutycycle = brightness ^ PWM_GAMMA
+#define PWM_CURVE_CIE                 2     // CIE 1931 lightness, brightness being L*
+
+#if !defined(PWM_BRIGHTNESS_BITS)
+  #define PWM_BRIGHTNESS_BITS         8
+#endif
+
+#if (PWM_BRIGHTNESS_BITS != 8) && (PWM_BRIGHTNESS_BITS != 10) && (PWM_BRIGHTNESS_BITS != 12)
+  #error PWM_BRIGHTNESS_BITS must be 8, 10 or 12
+#endif
+
+#if !defined(PWM_BRIGHTNESS_CURVE)
+  #define PWM_BRIGHTNESS_CURVE        PWM_CURVE_CIE
+#endif
+
+#if !defined(PWM_GAMMA)
+  #define PWM_GAMMA                   2.2
+#endif
+
+#define PWM_MAX_BRIGHTNESS            ( (1 << PWM_BRIGHTNESS_BITS) - 1 )
+
+// Full dutycycle, as a fraction of 65535
+#define PWM_MAX_DUTY_FRACTION         65535
+
+///////////////////////////////////////////////////
+
+// C++11 constexpr functions, one return statement each, so loops are recursions
+
+// exp(x) for x >= 0, by Taylor series
+constexpr double PWM_expSeries(const double x, const double term, const uint32_t n, const double sum)
+{
+  return (term < 1e-17 * sum) ? sum : PWM_expSeries(x, term * x / n, n + 1, sum + term);
+}
+
+constexpr double PWM_exp(const double x)
+{
+  return (x < 0) ? 1.0 / PWM_expSeries(-x, 1.0, 1, 0.0) : PWM_expSeries(x, 1.0, 1, 0.0);
+}
+
+// ln(y) = 2 * atanh(z), z = (y - 1) / (y + 1), for y in [0.5, 1], by series
+constexpr double PWM_atanhSeries(const double z2, const double power, const uint32_t n, const double sum)
+{
+  return (power / n < 1e-17) ? sum : PWM_atanhSeries(z2, power * z2, n + 2, sum + power / n);
+}
+
+// ln(y) for 0 < y <= 1, y being scaled by 2 down to [0.5, 1]
+constexpr double PWM_ln(const double y, const uint32_t halvings = 0)
+{
+  return (y < 0.5) ? PWM_ln(y * 2, halvings + 1) :
+         -2.0 * ( (1 - y) / (1 + y) ) * PWM_atanhSeries( ( (1 - y) / (1 + y) ) * ( (1 - y) / (1 + y) ), 1.0, 1, 0.0) 
+         - halvings * 0.69314718055994530942;
+}
+
+// Relative luminance, from 0.0 to 1.0, for x = brightness / PWM_MAX_BRIGHTNESS from 0.0 to 1.0
+constexpr double PWM_luminance(const uint8_t curve, const double x)
+{
+  return (curve == PWM_CURVE_LINEAR) ? x :
+         (curve == PWM_CURVE_GAMMA)  ? ( (x <= 0) ? 0.0 : PWM_exp(PWM_GAMMA * PWM_ln(x)) ) :
+         // CIE 1931, L* = 100 * x
+         (x <= 0.08) ? ( 100 * x / 903.3 ) : ( ( (100 * x + 16) / 116 ) * ( (100 * x + 16) / 116 ) * ( (100 * x + 16) / 116 ) );
+}
+
+constexpr uint16_t PWM_brightnessToDuty(const uint8_t curve, const uint32_t brightness, const uint32_t maxBrightness)
+{
+  return (uint16_t) ( PWM_luminance(curve, (double) brightness / maxBrightness) * PWM_MAX_DUTY_FRACTION + 0.5 );
+}
+
+///////////////////////////////////////////////////
+
+// Index sequence 0 .. N - 1, built in log2(N) steps not to hit the template instantiation depth limit
+template <uint32_t... I> 
+struct PWM_Seq {};
+
+template <class S1, class S2> 
+struct PWM_SeqConcat;
+
+template <uint32_t... I1, uint32_t... I2> 
+struct PWM_SeqConcat<PWM_Seq<I1...>, PWM_Seq<I2...>>
+{
+  typedef PWM_Seq<I1..., ( sizeof...(I1) + I2 )...> type;
+};
+
+template <uint32_t N> 
+struct PWM_MakeSeq
+{
+  typedef typename PWM_SeqConcat<typename PWM_MakeSeq<N / 2>::type, typename PWM_MakeSeq<N - N / 2>::type>::type type;
+};
+
+template <> 
+struct PWM_MakeSeq<0>
+{
+  typedef PWM_Seq<> type;
+};
+
+template <> 
+struct PWM_MakeSeq<1>
+{
+  typedef PWM_Seq<0> type;
+};
+
+///////////////////////////////////////////////////
+
+// PWM_BrightnessTable<curve, bits>::value[brightness] is the dutycycle fraction, from 0 to PWM_MAX_DUTY_FRACTION
+template <uint8_t curve, uint8_t bits, class Seq = typename PWM_MakeSeq<(1UL << bits)>::type>
+struct PWM_BrightnessTable;
+
+template <uint8_t curve, uint8_t bits, uint32_t... I>
+struct PWM_BrightnessTable<curve, bits, PWM_Seq<I...>>
+{
+  static constexpr uint16_t value[sizeof...(I)] = { PWM_brightnessToDuty(curve, I, (1UL << bits) - 1)... };
+};
+
+template <uint8_t curve, uint8_t bits, uint32_t... I>
+constexpr uint16_t PWM_BrightnessTable<curve, bits, PWM_Seq<I...>>::value[sizeof...(I)];
+
+// The table used by modifyBrightness()
+typedef PWM_BrightnessTable<PWM_BRIGHTNESS_CURVE, PWM_BRIGHTNESS_BITS>  PWM_Brightness;
+
+#endif    // PWM_BRIGHTNESS_H
@@ -55,6 +55,7 @@
 // 2: WARN: errors and warnings
 // 3: INFO: errors, warnings and informational (default)
 // 4: DEBUG: errors, warnings, informational and debug
+// Levels > 0 print to Serial, and can hang the system if used in ISR, unless PWM_LOG_TO_RING is true
 
 #ifndef _PWM_LOGLEVEL_
   #define _PWM_LOGLEVEL_       1
@@ -65,48 +66,102 @@
 const char PWM_MARK[]  = "[PWM] ";
 const char PWM_SPACE[] = " ";
 
-#define PWM_PRINT        PWM_DBG_PORT.print
-#define PWM_PRINTLN      PWM_DBG_PORT.println
+// Flags of a log call
+#define PWM_LOG_MARK          0x01        // starts with PWM_MARK
+#define PWM_LOG_SPACED        0x02        // items separated by PWM_SPACE
+#define PWM_LOG_NEWLINE       0x04        // ends the line
+
+// Log into a lock-free binary ring, safe from ISR, instead of printing to PWM_DBG_PORT.
+// Call PWM_LogRing_dump(PWM_DBG_PORT) periodically, outside ISR, to decode and print the records
+#ifndef PWM_LOG_TO_RING
+  #define PWM_LOG_TO_RING      false
+#endif
+
+#if PWM_LOG_TO_RING
+  #include <string.h>
+  #include "PWM_Log_Ring.h"
+
+  // One record per log call, whatever the number of items
+  #define PWM_LOG_ITEMS(flags, ...)   PWM_LogRing_log(flags, __VA_ARGS__)
+
+  #define PWM_PRINT(x)     PWM_LogRing_log(0, x)
+  #define PWM_PRINTLN(x)   PWM_LogRing_log(PWM_LOG_NEWLINE, x)
+#else
+  #define PWM_LOG_ITEMS(flags, ...)   PWM_printItems(flags, __VA_ARGS__)
+
+  #define PWM_PRINT        PWM_DBG_PORT.print
+  #define PWM_PRINTLN      PWM_DBG_PORT.println
+
+  inline void PWM_printItems(const uint8_t flags)
+  {
+    if (flags & PWM_LOG_NEWLINE)
+      PWM_DBG_PORT.println();
+  }
+
+  // Print the items of a log call, as the PWM_LOG_xyz flags say
+  template<typename T, typename... Args>
+  inline void PWM_printItems(const uint8_t flags, const T& item, const Args&... items)
+  {
+    if (flags & PWM_LOG_MARK)
+      PWM_DBG_PORT.print(PWM_MARK);
+
+    PWM_DBG_PORT.print(item);
+
+    if ( (flags & PWM_LOG_SPACED) && (sizeof...(items) > 0) )
+      PWM_DBG_PORT.print(PWM_SPACE);
+
+    PWM_printItems(flags & ~PWM_LOG_MARK, items...);
+  }
+#endif
 
 #define PWM_PRINT_MARK   PWM_PRINT(PWM_MARK)
 #define PWM_PRINT_SP     PWM_PRINT(PWM_SPACE)
 #define PWM_PRINT_LINE   PWM_PRINT(PWM_LINE)
 
+// PWM_LOGERROR(), PWM_LOGERROR1() etc. : "[PWM] x y z" and newline
+#define PWM_LOG_MARKED_LINE   (PWM_LOG_MARK | PWM_LOG_SPACED | PWM_LOG_NEWLINE)
+
+// PWM_LOGxyz_LINE() : up to 8 items printed back-to-back as one line, e.g. "Channel : ", 2, "\tPeriod : ", 1000
+
 ///////////////////////////////////////
 
-#define PWM_LOGERROR(x)         if(_PWM_LOGLEVEL_>0) { PWM_PRINT_MARK; PWM_PRINTLN(x); }
-#define PWM_LOGERROR0(x)        if(_PWM_LOGLEVEL_>0) { PWM_PRINT(x); }
-#define PWM_LOGERRORLN0(x)      if(_PWM_LOGLEVEL_>0) { PWM_PRINTLN(x); }
-#define PWM_LOGERROR1(x,y)      if(_PWM_LOGLEVEL_>0) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINTLN(y); }
-#define PWM_LOGERROR2(x,y,z)    if(_PWM_LOGLEVEL_>0) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINTLN(z); }
-#define PWM_LOGERROR3(x,y,z,w)  if(_PWM_LOGLEVEL_>0) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINT(z); PWM_PRINT_SP; PWM_PRINTLN(w); }
+#define PWM_LOGERROR(x)         if(_PWM_LOGLEVEL_>0) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x); }
+#define PWM_LOGERROR0(x)        if(_PWM_LOGLEVEL_>0) { PWM_LOG_ITEMS(0, x); }
+#define PWM_LOGERRORLN0(x)      if(_PWM_LOGLEVEL_>0) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, x); }
+#define PWM_LOGERROR1(x,y)      if(_PWM_LOGLEVEL_>0) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y); }
+#define PWM_LOGERROR2(x,y,z)    if(_PWM_LOGLEVEL_>0) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z); }
+#define PWM_LOGERROR3(x,y,z,w)  if(_PWM_LOGLEVEL_>0) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z, w); }
+#define PWM_LOGERROR_LINE(...)  if(_PWM_LOGLEVEL_>0) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, __VA_ARGS__); }
 
 ///////////////////////////////////////
 
-#define PWM_LOGWARN(x)          if(_PWM_LOGLEVEL_>1) { PWM_PRINT_MARK; PWM_PRINTLN(x); }
-#define PWM_LOGWARN0(x)         if(_PWM_LOGLEVEL_>1) { PWM_PRINT(x); }
-#define PWM_LOGWARNLN0(x)       if(_PWM_LOGLEVEL_>1) { PWM_PRINTLN(x); }
-#define PWM_LOGWARN1(x,y)       if(_PWM_LOGLEVEL_>1) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINTLN(y); }
-#define PWM_LOGWARN2(x,y,z)     if(_PWM_LOGLEVEL_>1) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINTLN(z); }
-#define PWM_LOGWARN3(x,y,z,w)   if(_PWM_LOGLEVEL_>1) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINT(z); PWM_PRINT_SP; PWM_PRINTLN(w); }
+#define PWM_LOGWARN(x)          if(_PWM_LOGLEVEL_>1) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x); }
+#define PWM_LOGWARN0(x)         if(_PWM_LOGLEVEL_>1) { PWM_LOG_ITEMS(0, x); }
+#define PWM_LOGWARNLN0(x)       if(_PWM_LOGLEVEL_>1) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, x); }
+#define PWM_LOGWARN1(x,y)       if(_PWM_LOGLEVEL_>1) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y); }
+#define PWM_LOGWARN2(x,y,z)     if(_PWM_LOGLEVEL_>1) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z); }
+#define PWM_LOGWARN3(x,y,z,w)   if(_PWM_LOGLEVEL_>1) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z, w); }
+#define PWM_LOGWARN_LINE(...)   if(_PWM_LOGLEVEL_>1) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, __VA_ARGS__); }
 
 ///////////////////////////////////////
 
-#define PWM_LOGINFO(x)          if(_PWM_LOGLEVEL_>2) { PWM_PRINT_MARK; PWM_PRINTLN(x); }
-#define PWM_LOGINFO0(x)         if(_PWM_LOGLEVEL_>2) { PWM_PRINT(x); }
-#define PWM_LOGINFOLN0(x)       if(_PWM_LOGLEVEL_>2) { PWM_PRINTLN(x); }
-#define PWM_LOGINFO1(x,y)       if(_PWM_LOGLEVEL_>2) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINTLN(y); }
-#define PWM_LOGINFO2(x,y,z)     if(_PWM_LOGLEVEL_>2) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINTLN(z); }
-#define PWM_LOGINFO3(x,y,z,w)   if(_PWM_LOGLEVEL_>2) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINT(z); PWM_PRINT_SP; PWM_PRINTLN(w); }
+#define PWM_LOGINFO(x)          if(_PWM_LOGLEVEL_>2) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x); }
+#define PWM_LOGINFO0(x)         if(_PWM_LOGLEVEL_>2) { PWM_LOG_ITEMS(0, x); }
+#define PWM_LOGINFOLN0(x)       if(_PWM_LOGLEVEL_>2) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, x); }
+#define PWM_LOGINFO1(x,y)       if(_PWM_LOGLEVEL_>2) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y); }
+#define PWM_LOGINFO2(x,y,z)     if(_PWM_LOGLEVEL_>2) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z); }
+#define PWM_LOGINFO3(x,y,z,w)   if(_PWM_LOGLEVEL_>2) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z, w); }
+#define PWM_LOGINFO_LINE(...)   if(_PWM_LOGLEVEL_>2) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, __VA_ARGS__); }
 
 ///////////////////////////////////////
 
-#define PWM_LOGDEBUG(x)         if(_PWM_LOGLEVEL_>3) { PWM_PRINT_MARK; PWM_PRINTLN(x); }
-#define PWM_LOGDEBUG0(x)        if(_PWM_LOGLEVEL_>3) { PWM_PRINT(x); }
-#define PWM_LOGDEBUGLN0(x)      if(_PWM_LOGLEVEL_>3) { PWM_PRINTLN(x); }
-#define PWM_LOGDEBUG1(x,y)      if(_PWM_LOGLEVEL_>3) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINTLN(y); }
-#define PWM_LOGDEBUG2(x,y,z)    if(_PWM_LOGLEVEL_>3) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINTLN(z); }
-#define PWM_LOGDEBUG3(x,y,z,w)  if(_PWM_LOGLEVEL_>3) { PWM_PRINT_MARK; PWM_PRINT(x); PWM_PRINT_SP; PWM_PRINT(y); PWM_PRINT_SP; PWM_PRINT(z); PWM_PRINT_SP; PWM_PRINTLN(w); }
+#define PWM_LOGDEBUG(x)         if(_PWM_LOGLEVEL_>3) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x); }
+#define PWM_LOGDEBUG0(x)        if(_PWM_LOGLEVEL_>3) { PWM_LOG_ITEMS(0, x); }
+#define PWM_LOGDEBUGLN0(x)      if(_PWM_LOGLEVEL_>3) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, x); }
+#define PWM_LOGDEBUG1(x,y)      if(_PWM_LOGLEVEL_>3) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y); }
+#define PWM_LOGDEBUG2(x,y,z)    if(_PWM_LOGLEVEL_>3) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z); }
+#define PWM_LOGDEBUG3(x,y,z,w)  if(_PWM_LOGLEVEL_>3) { PWM_LOG_ITEMS(PWM_LOG_MARKED_LINE, x, y, z, w); }
+#define PWM_LOGDEBUG_LINE(...)  if(_PWM_LOGLEVEL_>3) { PWM_LOG_ITEMS(PWM_LOG_NEWLINE, __VA_ARGS__); }
 
 ///////////////////////////////////////
 
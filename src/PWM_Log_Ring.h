@@ -0,0 +1,311 @@
+/****************************************************************************************************************************
+  PWM_Log_Ring.h
+  For ESP32, ESP32_S2, ESP32_S3, ESP32_C3 boards with ESP32 core v2.0.0+
+  Written by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/ESP32_PWM
+  Licensed under MIT license
+
+  The ESP32, ESP32_S2, ESP32_S3, ESP32_C3 have two timer groups, TIMER_GROUP_0 and TIMER_GROUP_1
+  1) each group of ESP32, ESP32_S2, ESP32_S3 has two general purpose hardware timers, TIMER_0 and TIMER_1
+  2) each group of ESP32_C3 has ony one general purpose hardware timer, TIMER_0
+
+  All the timers are based on 64-bit counters (except 54-bit counter for ESP32_S3 counter) and 16 bit prescalers.
+  The timer counters can be configured to count up or down and support automatic reload and software reload.
+  They can also generate alarms when they reach a specific value, defined by the software.
+  The value of the counter can be read by the software program.
+
+  Now even you use all these new 16 ISR-based timers,with their maximum interval practically unlimited (limited only by
+  unsigned long miliseconds), you just consume only one ESP32-S2 timer and avoid conflicting with other cores' tasks.
+  The accuracy is nearly perfect compared to software timers. The most important feature is they're ISR-based timers
+  Therefore, their executions are not blocked by bad-behaving functions / tasks.
+  This important feature is absolutely necessary for mission-critical tasks.
+
+  Version: 1.3.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      20/09/2021 Initial coding for ESP32, ESP32_S2, ESP32_C3 boards with ESP32 core v2.0.0+
+  1.0.1   K Hoang      21/09/2021 Fix bug. Ading PWM end-of-duty-cycle callback function. Improve examples
+  1.1.0   K Hoang      06/11/2021 Add functions to modify PWM settings on-the-fly
+  1.1.1   K Hoang      09/11/2021 Fix examples to not use GPIO1/TX0 for core v2.0.1+
+  1.2.0   K Hoang      29/01/2022 Fix multiple-definitions linker error. Improve accuracy. Fix bug
+  1.2.1   K Hoang      30/01/2022 DutyCycle to be updated at the end current PWM period
+  1.2.2   K Hoang      01/02/2022 Use float for DutyCycle and Freq, uint32_t for period. Optimize code
+  1.3.0   K Hoang      12/02/2022 Add support to new ESP32-S3
+  1.3.1   K Hoang      04/03/2022 Fix `DutyCycle` and `New Period` display bugs. Display warning only when debug level > 3
+  1.3.2   K Hoang      09/05/2022 Remove crashing PIN_D24 from examples
+  1.3.3   K Hoang      16/06/2022 Add support to new Adafruit boards
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef PWM_LOG_RING_H
+#define PWM_LOG_RING_H
+
+// ISR-safe logging backend, used when PWM_LOG_TO_RING is true.
+// Each PWM_LOGxyz call is stored, with all its items, as one 80-byte binary record into a lock-free ring, at the cost
+// of a few stores, and without any UART transaction. Text items are stored as pointers, so they must be string literals
+// or F(). The records are decoded later, outside the ISR, by PWM_LogRing_dump(), e.g. in loop() or in a low-priority task.
+
+#if !defined(PWM_LOG_RING_SIZE)
+  #define PWM_LOG_RING_SIZE       32
+#endif
+
+#if ( (PWM_LOG_RING_SIZE & (PWM_LOG_RING_SIZE - 1)) != 0 ) || (PWM_LOG_RING_SIZE > 16384)
+  #error PWM_LOG_RING_SIZE must be a power of 2, and <= 16384
+#endif
+
+#define PWM_LOG_MAX_ITEMS         8
+
+#define PWM_LOG_TYPE_TEXT         0
+#define PWM_LOG_TYPE_INT          1
+#define PWM_LOG_TYPE_UINT         2
+#define PWM_LOG_TYPE_FLOAT        3
+
+typedef struct
+{
+  uint32_t  timestamp;                      // micros() when logged
+  uint16_t  seq;                            // ( index + 1 ) of the record in the ring, written last to commit the record
+  uint8_t   flags;                          // PWM_LOG_MARK, PWM_LOG_SPACED, PWM_LOG_NEWLINE
+  uint8_t   count;                          // number of items
+  uint8_t   type[PWM_LOG_MAX_ITEMS];        // PWM_LOG_TYPE_xyz of each item
+  uint64_t  value[PWM_LOG_MAX_ITEMS];       // text pointer, integer or double
+} PWM_LogRecord_t;
+
+typedef struct
+{
+  PWM_LogRecord_t   record[PWM_LOG_RING_SIZE];
+  uint32_t          head;         // next index to be reserved by a writer. Only changed by atomic fetch-and-add
+  uint32_t          tail;         // next index to be read by PWM_LogRing_dump()
+  uint32_t          dropped;      // records overwritten before being read
+} PWM_LogRing_t;
+
+// One ring for the whole program. Zero-initialized, so no guard variable is needed
+inline PWM_LogRing_t& PWM_getLogRing()
+{
+  static PWM_LogRing_t logRing;
+
+  return logRing;
+}
+
+///////////////////////////////////////
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const uint8_t type, const uint64_t value)
+{
+  record.type[record.count]   = type;
+  record.value[record.count]  = value;
+  record.count++;
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const char* text)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_TEXT, (uintptr_t) text);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const __FlashStringHelper* text)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_TEXT, (uintptr_t) text);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const int value)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_INT, (uint64_t) (int64_t) value);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const long value)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_INT, (uint64_t) (int64_t) value);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const long long value)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_INT, (uint64_t) value);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const unsigned int value)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_UINT, value);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const unsigned long value)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_UINT, value);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const unsigned long long value)
+{
+  PWM_LogRing_item(record, PWM_LOG_TYPE_UINT, value);
+}
+
+inline void IRAM_ATTR PWM_LogRing_item(PWM_LogRecord_t& record, const double value)
+{
+  uint64_t bits;
+
+  memcpy(&bits, &value, sizeof(bits));
+
+  PWM_LogRing_item(record, PWM_LOG_TYPE_FLOAT, bits);
+}
+
+inline void IRAM_ATTR PWM_LogRing_items(PWM_LogRecord_t& record)
+{
+  (void) record;
+}
+
+template<typename T, typename... Args>
+inline void IRAM_ATTR PWM_LogRing_items(PWM_LogRecord_t& record, const T& item, const Args&... items)
+{
+  PWM_LogRing_item(record, item);
+  PWM_LogRing_items(record, items...);
+}
+
+///////////////////////////////////////
+
+// Lock-free, from any task, ISR or core. Writes one record with all the items of a log call, so that lines logged
+// at the same time by other writers can't be mixed up. When the ring is full, the oldest records are overwritten
+template<typename... Args>
+inline void IRAM_ATTR PWM_LogRing_log(const uint8_t flags, const Args&... items)
+{
+  static_assert(sizeof...(items) <= PWM_LOG_MAX_ITEMS, "Too many items in one log call");
+
+  PWM_LogRing_t& logRing = PWM_getLogRing();
+
+  uint32_t index = __atomic_fetch_add(&logRing.head, 1, __ATOMIC_RELAXED);
+
+  PWM_LogRecord_t& record = logRing.record[index & (PWM_LOG_RING_SIZE - 1)];
+
+  // Half a sequence behind while being filled : the reader takes it as not yet committed, and drops a copy of the
+  // previous record of the slot torn by this write
+  __atomic_store_n(&record.seq, (uint16_t) (index + 1 - 0x8000), __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  record.timestamp  = micros();
+  record.flags      = flags;
+  record.count      = 0;
+
+  PWM_LogRing_items(record, items...);
+
+  __atomic_store_n(&record.seq, (uint16_t) (index + 1), __ATOMIC_RELEASE);
+}
+
+///////////////////////////////////////
+
+// Decode and print all the records logged since the last call. Not to be called from ISR.
+// Returns the number of records printed
+template<typename T>
+uint32_t PWM_LogRing_dump(T& out)
+{
+  PWM_LogRing_t& logRing  = PWM_getLogRing();
+  uint32_t      printed   = 0;
+  bool          lineStart = true;
+
+  while (logRing.tail != __atomic_load_n(&logRing.head, __ATOMIC_ACQUIRE))
+  {
+    uint32_t head = __atomic_load_n(&logRing.head, __ATOMIC_ACQUIRE);
+
+    // The writers have lapped the reader. Skip to the oldest record still in the ring
+    if (head - logRing.tail > PWM_LOG_RING_SIZE)
+    {
+      logRing.dropped += head - logRing.tail - PWM_LOG_RING_SIZE;
+      logRing.tail     = head - PWM_LOG_RING_SIZE;
+    }
+
+    PWM_LogRecord_t&  slot      = logRing.record[logRing.tail & (PWM_LOG_RING_SIZE - 1)];
+    uint16_t          expected  = (uint16_t) (logRing.tail + 1);
+    uint16_t          seq       = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+
+    if (seq != expected)
+    {
+      if ( (int16_t) (seq - expected) < 0 )
+      {
+        // Reserved, but not yet committed by its writer. Try again next time
+        break;
+      }
+
+      // Already overwritten by a newer record
+      logRing.dropped++;
+      logRing.tail++;
+      continue;
+    }
+
+    PWM_LogRecord_t record = slot;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    // Overwritten while being copied
+    if (__atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE) != expected)
+    {
+      logRing.dropped++;
+      logRing.tail++;
+      continue;
+    }
+
+    logRing.tail++;
+    printed++;
+
+    if (lineStart)
+    {
+      out.print(record.timestamp);
+      out.print(F(": "));
+    }
+
+    if (record.flags & PWM_LOG_MARK)
+    {
+      out.print(PWM_MARK);
+    }
+
+    for (uint8_t i = 0; (i < record.count) && (i < PWM_LOG_MAX_ITEMS); i++)
+    {
+      if ( (i > 0) && (record.flags & PWM_LOG_SPACED) )
+      {
+        out.print(PWM_SPACE);
+      }
+
+      switch (record.type[i])
+      {
+        case PWM_LOG_TYPE_TEXT:
+          out.print( (const char*) (uintptr_t) record.value[i] );
+          break;
+
+        case PWM_LOG_TYPE_INT:
+          out.print( (long long) record.value[i] );
+          break;
+
+        case PWM_LOG_TYPE_UINT:
+          out.print( (unsigned long long) record.value[i] );
+          break;
+
+        case PWM_LOG_TYPE_FLOAT:
+        {
+          double value;
+
+          memcpy(&value, &record.value[i], sizeof(value));
+          out.print(value);
+          break;
+        }
+      }
+    }
+
+    lineStart = (record.flags & PWM_LOG_NEWLINE);
+
+    if (lineStart)
+    {
+      out.println();
+    }
+  }
+
+  if (!lineStart)
+  {
+    out.println();
+  }
+
+  return printed;
+}
+
+// Number of records overwritten before being read by PWM_LogRing_dump()
+inline uint32_t PWM_LogRing_dropped()
+{
+  return PWM_getLogRing().dropped;
+}
+
+#endif    //PWM_LOG_RING_H
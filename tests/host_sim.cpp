@@ -0,0 +1,71 @@
+// Host simulation of the pins and timer, shared by the tests
+#include "host_sim.h"
+#include <hal/cpu_hal.h>
+#include <hal/timer_ll.h>
+#include <soc/gpio_reg.h>
+
+uint64_t      host_now_us   = 0;
+uint32_t      host_cycles   = 0;
+
+uint64_t      host_alarm_value    = 0;
+uint64_t      host_counter_value  = 0;
+bool          host_auto_reload    = false;
+timer_isr_t   host_isr_fn         = nullptr;
+void*         host_isr_arg        = nullptr;
+int           host_isr_flags      = 0;
+timg_dev_t    host_timg[2];
+
+int           host_pin_level[64];
+uint32_t      host_rise_count[64];
+uint32_t      host_writes   = 0;
+int           host_failures = 0;
+
+void (*host_edge_hook)(int pin, int level) = nullptr;
+void (*host_write_hook)()                   = nullptr;
+
+HostSerial Serial;
+
+static void host_set_pin(int pin, int level)
+{
+  if (level == host_pin_level[pin])
+    return;
+
+  if (level)
+    host_rise_count[pin]++;
+
+  host_pin_level[pin] = level;
+
+  if (host_edge_hook)
+    host_edge_hook(pin, level);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (host_write_hook)
+    host_write_hook();
+
+  host_set_pin(pin, val ? HIGH : LOW);
+  host_writes++;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return host_pin_level[pin];
+}
+
+void host_reg_write(int reg, uint32_t val)
+{
+  if (host_write_hook)
+    host_write_hook();
+
+  int base  = (reg == GPIO_OUT1_W1TS_REG || reg == GPIO_OUT1_W1TC_REG) ? 32 : 0;
+  int level = (reg == GPIO_OUT_W1TS_REG  || reg == GPIO_OUT1_W1TS_REG) ? HIGH : LOW;
+
+  for (int i = 0; i < 32; i++)
+  {
+    if (val & (1UL << i))
+      host_set_pin(base + i, level);
+  }
+
+  host_writes++;
+}
@@ -0,0 +1,33 @@
+// Host simulation of the pins and timer, shared by the tests
+#pragma once
+
+#include <Arduino.h>
+#include <stdio.h>
+
+extern int      host_pin_level[64];
+extern uint32_t host_rise_count[64];
+extern uint32_t host_writes;
+extern int      host_failures;
+
+// Called on every pin change, with the new level
+extern void (*host_edge_hook)(int pin, int level);
+
+// Called once at the start of every digitalWrite() / register write, before the pins change
+extern void (*host_write_hook)();
+
+#define CHECK(cond)                                                             \
+  do                                                                            \
+  {                                                                             \
+    if (!(cond))                                                                \
+    {                                                                           \
+      printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);           \
+      host_failures++;                                                          \
+    }                                                                           \
+  } while (0)
+
+// Return value of main()
+inline int host_result(const char* name)
+{
+  printf("%s : %s\n", name, host_failures ? "FAILED" : "passed");
+  return host_failures ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+// Host stub of the Arduino core, only what the library and the examples use
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <iostream>
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           1
+#define OUTPUT          3
+
+#define ARDUINO_BOARD   "HOST"
+#define F_CPU           240000000
+
+class __FlashStringHelper;
+#define F(x)            ((const __FlashStringHelper*)(x))
+
+typedef unsigned long ulong;
+
+// Simulated time, in us. The tests move it forward
+extern uint64_t host_now_us;
+
+inline unsigned long micros()   { return (unsigned long) host_now_us; }
+inline unsigned long millis()   { return (unsigned long) (host_now_us / 1000); }
+inline void delay(uint32_t ms)  { host_now_us += 1000ULL * ms; }
+inline uint32_t getCpuFrequencyMhz() { return F_CPU / 1000000; }
+
+inline void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+struct HostSerial
+{
+  bool echo = false;
+
+  template<class T> void print(const T& t)        { if (echo) std::cout << t; }
+  void print(const __FlashStringHelper* t)        { if (echo) std::cout << (const char*) t; }
+  template<class T> void print(const T& t, int)   { print(t); }
+  template<class T> void println(const T& t)      { print(t); println(); }
+  void println()                                  { if (echo) std::cout << std::endl; }
+  void begin(unsigned long)                       {}
+  operator bool() const                           { return true; }
+};
+
+extern HostSerial Serial;
+
+// One lock for all the muxes, enough for the tests
+typedef struct { int owner; int count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    { 0, 0 }
+
+inline std::atomic_flag& host_mux() { static std::atomic_flag f = ATOMIC_FLAG_INIT; return f; }
+inline void host_lock()   { while (host_mux().test_and_set(std::memory_order_acquire)) {} }
+inline void host_unlock() { host_mux().clear(std::memory_order_release); }
+
+#define portENTER_CRITICAL(m)       host_lock()
+#define portEXIT_CRITICAL(m)        host_unlock()
+#define portENTER_CRITICAL_ISR(m)   host_lock()
+#define portEXIT_CRITICAL_ISR(m)    host_unlock()
+
+#define ESP_INTR_FLAG_IRAM          (1 << 10)
+#define TIMER_BASE_CLK              80000000
+
+#include "freertos/FreeRTOS.h"
@@ -0,0 +1,8 @@
+// Host stub of SimpleTimer, used by the examples
+#pragma once
+
+struct SimpleTimer
+{
+  int  setInterval(long, void (*)()) { return 0; }
+  void run() {}
+};
@@ -0,0 +1,60 @@
+// Host stub of the ESP-IDF timer driver. The alarm, counter and ISR are kept in globals
+#pragma once
+
+#include <stdint.h>
+
+typedef enum { TIMER_GROUP_0 = 0, TIMER_GROUP_1 = 1, TIMER_GROUP_MAX } timer_group_t;
+typedef enum { TIMER_0 = 0, TIMER_1 = 1, TIMER_MAX } timer_idx_t;
+typedef enum { TIMER_COUNT_DOWN = 0, TIMER_COUNT_UP = 1, TIMER_COUNT_MAX } timer_count_dir_t;
+typedef enum { TIMER_PAUSE = 0, TIMER_START = 1 } timer_start_t;
+typedef enum { TIMER_ALARM_DIS = 0, TIMER_ALARM_EN = 1, TIMER_ALARM_MAX } timer_alarm_t;
+typedef enum { TIMER_INTR_LEVEL = 0, TIMER_INTR_MAX } timer_intr_mode_t;
+typedef enum { TIMER_AUTORELOAD_DIS = 0, TIMER_AUTORELOAD_EN = 1, TIMER_AUTORELOAD_MAX } timer_autoreload_t;
+typedef enum { TIMER_INTR_T0 = 1, TIMER_INTR_T1 = 2 } timer_intr_t;
+
+typedef struct
+{
+  timer_alarm_t       alarm_en;
+  timer_start_t       counter_en;
+  timer_intr_mode_t   intr_type;
+  timer_count_dir_t   counter_dir;
+  timer_autoreload_t  auto_reload;
+  uint32_t            divider;
+} timer_config_t;
+
+typedef bool (*timer_isr_t)(void *);
+typedef int esp_err_t;
+
+extern uint64_t           host_alarm_value;
+extern uint64_t           host_counter_value;
+extern bool               host_auto_reload;
+extern timer_isr_t        host_isr_fn;
+extern void*              host_isr_arg;
+extern int                host_isr_flags;
+
+inline esp_err_t timer_init(timer_group_t, timer_idx_t, const timer_config_t* config)
+{
+  host_auto_reload = (config->auto_reload == TIMER_AUTORELOAD_EN);
+  return 0;
+}
+
+inline esp_err_t timer_set_counter_value(timer_group_t, timer_idx_t, uint64_t value)      { host_counter_value = value; return 0; }
+inline esp_err_t timer_get_counter_value(timer_group_t, timer_idx_t, uint64_t* value)     { *value = host_counter_value; return 0; }
+inline esp_err_t timer_set_alarm_value(timer_group_t, timer_idx_t, uint64_t value)        { host_alarm_value = value; return 0; }
+inline esp_err_t timer_set_auto_reload(timer_group_t, timer_idx_t, timer_autoreload_t r)  { host_auto_reload = r; return 0; }
+inline esp_err_t timer_set_divider(timer_group_t, timer_idx_t, uint32_t)                  { return 0; }
+inline esp_err_t timer_enable_intr(timer_group_t, timer_idx_t)                            { return 0; }
+inline esp_err_t timer_start(timer_group_t, timer_idx_t)                                  { return 0; }
+inline esp_err_t timer_pause(timer_group_t, timer_idx_t)                                  { return 0; }
+inline esp_err_t timer_group_intr_enable(timer_group_t, timer_intr_t)                     { return 0; }
+inline esp_err_t timer_group_intr_disable(timer_group_t, timer_intr_t)                    { return 0; }
+inline esp_err_t timer_isr_callback_remove(timer_group_t, timer_idx_t)                    { host_isr_fn = nullptr; return 0; }
+
+inline esp_err_t timer_isr_callback_add(timer_group_t, timer_idx_t, timer_isr_t fn, void* arg, int flags)
+{
+  host_isr_fn     = fn;
+  host_isr_arg    = arg;
+  host_isr_flags  = flags;
+  return 0;
+}
+
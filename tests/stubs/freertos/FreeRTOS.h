@@ -0,0 +1,67 @@
+// Host stub of the FreeRTOS task notifications
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+struct HostTask
+{
+  std::mutex              m;
+  std::condition_variable cv;
+  bool                    pending = false;
+  uint32_t                value   = 0;
+};
+
+typedef HostTask*   TaskHandle_t;
+typedef int         BaseType_t;
+typedef uint32_t    TickType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       0xffffffffUL
+#define pdMS_TO_TICKS(x)    (x)
+#define portYIELD_FROM_ISR(...)
+
+typedef enum { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite } eNotifyAction;
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  static thread_local HostTask task;
+  return &task;
+}
+
+inline BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction, BaseType_t* woken)
+{
+  {
+    std::lock_guard<std::mutex> lock(task->m);
+    task->pending = true;
+    task->value   = value;
+  }
+
+  task->cv.notify_one();
+
+  if (woken)
+    *woken = pdTRUE;
+
+  return pdTRUE;
+}
+
+inline BaseType_t xTaskNotifyWait(uint32_t, uint32_t, uint32_t* value, TickType_t ticks)
+{
+  HostTask* task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->m);
+
+  if (ticks == portMAX_DELAY)
+    task->cv.wait(lock, [task] { return task->pending; });
+  else if (!task->cv.wait_for(lock, std::chrono::milliseconds(ticks), [task] { return task->pending; }))
+    return pdFALSE;
+
+  task->pending = false;
+
+  if (value)
+    *value = task->value;
+
+  return pdTRUE;
+}
@@ -0,0 +1,11 @@
+// Host stub of the CPU cycle counter. Each read moves it forward, so that busy waits end
+#pragma once
+
+#include <stdint.h>
+
+extern uint32_t host_cycles;
+
+inline uint32_t cpu_hal_get_cycle_count()
+{
+  return host_cycles += 12;
+}
@@ -0,0 +1,15 @@
+// Host stub of the timer low level registers
+#pragma once
+
+#include <stdint.h>
+#include <driver/timer.h>
+
+typedef struct { int group; } timg_dev_t;
+
+extern timg_dev_t host_timg[2];
+
+#define TIMER_LL_GET_HW(num)    (&host_timg[(num)])
+
+inline void timer_ll_set_alarm_value(timg_dev_t*, timer_idx_t, uint64_t value)     { host_alarm_value = value; }
+inline void timer_ll_get_counter_value(timg_dev_t*, timer_idx_t, uint64_t* value)  { *value = host_counter_value; }
+inline void timer_ll_set_counter_value(timg_dev_t*, timer_idx_t, uint64_t value)   { host_counter_value = value; }
@@ -0,0 +1,13 @@
+// Host stub of the GPIO set / clear registers
+#pragma once
+
+#include <stdint.h>
+
+#define GPIO_OUT_W1TS_REG     1
+#define GPIO_OUT_W1TC_REG     2
+#define GPIO_OUT1_W1TS_REG    3
+#define GPIO_OUT1_W1TC_REG    4
+
+void host_reg_write(int reg, uint32_t val);
+
+#define REG_WRITE(reg, val)   host_reg_write((reg), (val))
@@ -0,0 +1,2 @@
+#pragma once
+#include "gpio_reg.h"
@@ -0,0 +1,126 @@
+// Cost of the slot allocator, of the handle and pin lookups, and stale handles rejected once their slot is reused.
+// Deletes applied at once, without run()
+#define _PWM_LOGLEVEL_                0
+#define USING_MICROS_RESOLUTION       true
+#define CHANGING_PWM_END_OF_CYCLE     false
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+ESP32_PWM ISR_PWM;
+
+static const int pins[16] = { 2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26 };
+
+static volatile int sink;
+
+static double nsSince(const Clock::time_point& start, const int& count)
+{
+  return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / count;
+}
+
+int main()
+{
+  const int iterations = 100000;
+
+  for (int i = 0; i < 16; i++)
+    CHECK(ISR_PWM.setPWM(pins[i], 100 + 7 * i, 10 + 5 * i) == i);
+
+  CHECK(ISR_PWM.getNumAvailablePWMChannels() == 0);
+
+  // A deleted channel's handle is rejected once its slot is reused
+  PWM_Handle_t handles[16];
+
+  for (int i = 0; i < 16; i++)
+    handles[i] = ISR_PWM.getHandle(i);
+
+  ISR_PWM.deleteChannel(9);
+
+  CHECK(ISR_PWM.getChannelFromHandle(handles[9]) == -1);
+  CHECK(ISR_PWM.getChannelByPin(pins[9]) == -1);
+
+  // The only free slot
+  CHECK(ISR_PWM.setPWM(pins[9], 50.0f, 50.0f) == 9);
+
+  CHECK(ISR_PWM.getChannelFromHandle(handles[9]) == -1);
+  CHECK(ISR_PWM.getChannelFromHandle(handles[8]) == 8);
+  CHECK(ISR_PWM.getChannelFromHandle(ISR_PWM.getHandle(9)) == 9);
+  CHECK(ISR_PWM.getChannelByPin(pins[9]) == 9);
+
+  // Lowest free slot first
+  ISR_PWM.deleteChannel(12);
+  ISR_PWM.deleteChannel(3);
+
+  CHECK(ISR_PWM.setPWM(pins[3], 50.0f, 50.0f) == 3);
+  CHECK(ISR_PWM.setPWM(pins[12], 50.0f, 50.0f) == 12);
+
+  // Delete and create again, in a different slot each time
+  Clock::time_point start = Clock::now();
+
+  for (int i = 0; i < iterations; i++)
+  {
+    int channelNum = i % 16;
+
+    ISR_PWM.deleteChannel(channelNum);
+    sink = ISR_PWM.setPWM(pins[channelNum], 100.0f, 50.0f);
+  }
+
+  double allocNs = nsSince(start, iterations);
+
+  CHECK(ISR_PWM.getNumAvailablePWMChannels() == 0);
+
+  PWM_Handle_t live[16];
+
+  for (int i = 0; i < 16; i++)
+    live[i] = ISR_PWM.getHandle(i);
+
+  // All the handles taken before are stale now
+  int staleFound = 0;
+
+  for (int i = 0; i < 16; i++)
+    staleFound += (ISR_PWM.getChannelFromHandle(handles[i]) >= 0);
+
+  CHECK(staleFound == 0);
+
+  start = Clock::now();
+
+  for (int i = 0; i < iterations; i++)
+    sink = ISR_PWM.getChannelFromHandle(live[i % 16]);
+
+  double liveNs = nsSince(start, iterations);
+
+  start = Clock::now();
+
+  for (int i = 0; i < iterations; i++)
+    sink = ISR_PWM.getChannelFromHandle(handles[i % 16]);
+
+  double staleNs = nsSince(start, iterations);
+
+  start = Clock::now();
+
+  for (int i = 0; i < iterations; i++)
+    sink = ISR_PWM.getChannelByPin(pins[i % 16]);
+
+  double pinNs = nsSince(start, iterations);
+
+  start = Clock::now();
+
+  for (int i = 0; i < iterations; i++)
+    sink = ISR_PWM.modifyPWMChannelByPin(pins[i % 16], 100.0f, (float) (i % 100));
+
+  double modifyNs = nsSince(start, iterations);
+
+  printf("deleteChannel() + setPWM() %.1f ns, getChannelFromHandle() live %.1f ns, stale %.1f ns\n",
+         allocNs, liveNs, staleNs);
+  printf("getChannelByPin() %.1f ns, modifyPWMChannelByPin() %.1f ns\n", pinNs, modifyNs);
+
+  for (int i = 0; i < 16; i++)
+    CHECK(ISR_PWM.getChannelByPin(pins[i]) == i);
+
+  CHECK(!ISR_PWM.modifyPWMChannelByPin(27, 100.0f, 50.0f));
+
+  return host_result("test_alloc");
+}
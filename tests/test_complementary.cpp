@@ -0,0 +1,68 @@
+// setPWM_Complementary() : the two outputs are never HIGH together, and dead-time is kept
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+ESP32_PWM ISR_PWM;
+
+int main()
+{
+  // 2000us period, no dead-time, and 5000us period with 100us dead-time
+  int pair    = ISR_PWM.setPWM_Complementary(2, 4, 500.0f, 40.0f, 0);
+  int paired  = ISR_PWM.setPWM_Complementary(12, 13, 200.0f, 50.0f, 100);
+
+  CHECK(pair >= 0 && paired >= 0);
+
+  uint64_t  overlap = 0;
+  uint64_t  highA   = 0;
+  uint64_t  highB   = 0;
+  uint64_t  dead    = 0;
+  uint64_t  samples = 0;
+  unsigned  seed    = 7;
+
+  // 10s with a jittery 15 - 25us tick
+  for (host_now_us = 0; host_now_us < 10000000ULL; )
+  {
+    seed = seed * 1103515245 + 12345;
+    host_now_us += 15 + (seed >> 16) % 11;
+
+    ISR_PWM.run();
+
+    if ( (host_pin_level[2] && host_pin_level[4]) || (host_pin_level[12] && host_pin_level[13]) )
+      overlap++;
+
+    if (!host_pin_level[12] && !host_pin_level[13])
+      dead++;
+
+    highA += host_pin_level[2];
+    highB += host_pin_level[4];
+    samples++;
+  }
+
+  printf("overlap %llu, A high %.2f%%, B high %.2f%%, dead %.2f%%\n", (unsigned long long) overlap,
+         100.0 * highA / samples, 100.0 * highB / samples, 100.0 * dead / samples);
+
+  CHECK(overlap == 0);
+
+  // About 40% and 60%, less one tick each cycle
+  CHECK(highA > samples * 38 / 100 && highA < samples * 41 / 100);
+  CHECK(highB > samples * 57 / 100 && highB < samples * 60 / 100);
+
+  // Two dead-times of 100us in each 5000us period
+  CHECK(dead > samples * 4 / 100);
+
+  // Both outputs end LOW
+  ISR_PWM.disable(paired);
+
+  for (int i = 0; i < 1000; i++)
+  {
+    host_now_us += 20;
+    ISR_PWM.run();
+  }
+
+  CHECK(!host_pin_level[12] && !host_pin_level[13]);
+
+  return host_result("test_complementary");
+}
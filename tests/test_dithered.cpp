@@ -0,0 +1,71 @@
+// setPWM_Dithered() : the measured average dutycycle of the pin is the requested one, in both time units
+#define _PWM_LOGLEVEL_                1
+
+#if !defined(USING_MICROS_RESOLUTION)
+  #define USING_MICROS_RESOLUTION     true
+#endif
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+#include <math.h>
+
+ESP32_PWM ISR_PWM;
+
+int main()
+{
+#if USING_MICROS_RESOLUTION
+  // 2500us period, run() every 1us, 4000 cycles
+  const float     freq    = 400.0f;
+  const uint64_t  tick    = 1;
+  const uint64_t  time    = 10ULL * 1000000ULL;
+  const char*     name    = "test_dithered";
+#else
+  // 20ms period, run() every 20us, 10000 cycles
+  const float     freq    = 50.0f;
+  const uint64_t  tick    = 20;
+  const uint64_t  time    = 200ULL * 1000000ULL;
+  const char*     name    = "test_dithered_millis";
+#endif
+
+  const float duty[]  = { 12.3456f, 0.5f, 12.3456f, 0.5f };
+  const int   pins[]  = { 2, 4, 5, 12 };
+
+  for (int i = 0; i < 4; i++)
+  {
+    int channel = (i < 2) ? ISR_PWM.setPWM(pins[i], freq, duty[i]) : ISR_PWM.setPWM_Dithered(pins[i], freq, duty[i]);
+
+    CHECK(channel >= 0);
+  }
+
+  uint64_t high[4] = { 0 };
+
+  for (host_now_us = 0; host_now_us < time; host_now_us += tick)
+  {
+    ISR_PWM.run();
+
+    for (int i = 0; i < 4; i++)
+      high[i] += host_pin_level[pins[i]] ? tick : 0;
+  }
+
+  double measured[4];
+
+  for (int i = 0; i < 4; i++)
+  {
+    measured[i] = 100.0 * high[i] / time;
+
+    printf("%s %.4f%% : %.4f%%\n", (i < 2) ? "plain   " : "dithered", duty[i], measured[i]);
+  }
+
+  // Within 1 LSB16
+  CHECK(fabs(measured[2] - duty[2]) < 100.0 / 65536);
+  CHECK(fabs(measured[3] - duty[3]) < 100.0 / 65536);
+
+#if !USING_MICROS_RESOLUTION
+  // A plain channel gets a whole number of ms, plus one, less the tick before its pulse starts : 3ms and 1ms
+  CHECK(fabs(measured[0] - 14.9) < 0.01);
+  CHECK(fabs(measured[1] - 4.9) < 0.01);
+#endif
+
+  return host_result(name);
+}
@@ -0,0 +1,60 @@
+// setPWM_Exact() : the frequency of an exact channel does not drift over one simulated hour
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+ESP32_PWM ISR_PWM;
+
+int main()
+{
+  const float     freq[]  = { 3.0f, 7.0f, 3.0f, 7.0f };
+  const int       pins[]  = { 2, 4, 5, 12 };
+  const uint64_t  tick    = 20;
+  const uint64_t  hour    = 3600ULL * 1000000ULL;
+
+  for (int i = 0; i < 2; i++)
+    CHECK(ISR_PWM.setPWM_Exact(pins[i], freq[i], 33.3f) >= 0);
+
+  for (int i = 2; i < 4; i++)
+    CHECK(ISR_PWM.setPWM(pins[i], freq[i], 33.3f) >= 0);
+
+  uint64_t lastRise[4] = { 0 };
+  int      last[4]     = { 0 };
+
+  for (host_now_us = 0; host_now_us < hour; host_now_us += tick)
+  {
+    ISR_PWM.run();
+
+    for (int i = 0; i < 4; i++)
+    {
+      if (host_pin_level[pins[i]] && !last[i])
+        lastRise[i] = host_now_us;
+
+      last[i] = host_pin_level[pins[i]];
+    }
+  }
+
+  for (int i = 0; i < 4; i++)
+  {
+    uint32_t  rises = host_rise_count[pins[i]];
+    double    drift = lastRise[i] - (rises - 1) * 1e6 / freq[i];
+
+    printf("%s %.0fHz : %u cycles, last rise %.1fus from ideal\n", i < 2 ? "exact" : "plain", freq[i], rises, drift);
+
+    if (i < 2)
+    {
+      // After 10800 / 25200 cycles, still within one tick of the ideal instant
+      CHECK(rises == (uint32_t) (3600 * freq[i]));
+      CHECK(drift >= 0 && drift <= tick);
+    }
+    else
+    {
+      // The truncated period and the tick latency make a plain channel run slow
+      CHECK(drift > 1000);
+    }
+  }
+
+  return host_result("test_exact");
+}
@@ -0,0 +1,75 @@
+// attachTimer() : the timer is paused while all channels are steady, without counting the skipped cycles as overruns
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+ESP32Timer ITimer(0);
+ESP32_PWM  ISR_PWM;
+
+bool IRAM_ATTR TimerHandler(void * timerNo)
+{
+  (void) timerNo;
+
+  ISR_PWM.run();
+
+  return true;
+}
+
+// Interrupts raised by the timer in 'us', on a 20us tick
+static uint32_t simulate(const uint64_t& us)
+{
+  uint32_t isrs = 0;
+
+  for (uint64_t end = host_now_us + us; host_now_us < end; )
+  {
+    host_now_us += 20;
+
+    if (host_alarm_value != TIMER_IDLE_ALARM_VALUE)
+    {
+      host_isr_fn(host_isr_arg);
+      isrs++;
+    }
+  }
+
+  return isrs;
+}
+
+int main()
+{
+  CHECK(ITimer.attachInterruptInterval(20, TimerHandler));
+
+  ISR_PWM.attachTimer(&ITimer);
+
+  // 400Hz, at 0% and 100%
+  int low   = ISR_PWM.setPWM(2, 400.0f, 0.0f);
+  int high  = ISR_PWM.setPWM(4, 400.0f, 100.0f);
+
+  CHECK(low >= 0 && high >= 0);
+
+  uint32_t isrs = simulate(1000000);
+
+  printf("steady : %u ISRs, idle %d, overruns %u %u\n", isrs, ISR_PWM.isTimerIdle(),
+         ISR_PWM.getOverruns(low), ISR_PWM.getOverruns(high));
+
+  CHECK(isrs < 10);
+  CHECK(ISR_PWM.isTimerIdle());
+  CHECK(host_pin_level[2] == LOW && host_pin_level[4] == HIGH);
+  CHECK(ISR_PWM.getOverruns(low) == 0 && ISR_PWM.getOverruns(high) == 0);
+
+  // Running again after an idle second
+  CHECK(ISR_PWM.modifyPWMChannel(low, 2, 400.0f, 50.0f));
+
+  host_rise_count[2] = 0;
+  isrs = simulate(1000000);
+
+  printf("50%% : %u ISRs, %u pulses, overruns %u %u\n", isrs, host_rise_count[2],
+         ISR_PWM.getOverruns(low), ISR_PWM.getOverruns(high));
+
+  CHECK(isrs == 50000);
+  CHECK(host_rise_count[2] >= 399 && host_rise_count[2] <= 401);
+  CHECK(ISR_PWM.getOverruns(low) == 0 && ISR_PWM.getOverruns(high) == 0);
+
+  return host_result("test_idle");
+}
@@ -0,0 +1,130 @@
+// Delay of each channel's edges from the ISR entry, for 1, 8 and 16 channels. Built with and without
+// PWM_PIPELINED_ISR : pipelined, the delay doesn't depend on the channel index, nor on the number of channels
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// A GPIO write on the APB bus, in ns
+#define WRITE_NS                      80
+
+static const int pins[16] = { 2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26 };
+
+static Clock::time_point  entry;
+static Clock::time_point  writeTime;
+static int                pinIndex[64];
+static std::vector<int>   delays[16];
+
+static void writeHook()
+{
+  writeTime = Clock::now();
+
+  // Busy for the duration of the write
+  while (Clock::now() - writeTime < std::chrono::nanoseconds(WRITE_NS)) {}
+}
+
+static void edgeHook(int pin, int level)
+{
+  (void) level;
+
+  // All the pins of a masked write change at the start of the write
+  if (pinIndex[pin] >= 0)
+    delays[pinIndex[pin]].push_back( (int) std::chrono::duration_cast<std::chrono::nanoseconds>(writeTime - entry).count() );
+}
+
+static int median(std::vector<int>& samples)
+{
+  std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+
+  return samples[samples.size() / 2];
+}
+
+int main()
+{
+  static ESP32_PWM engines[3];
+
+  const int counts[3] = { 1, 8, 16 };
+  int       minDelay  = 1000000;
+  int       maxDelay  = 0;
+  int       first16   = 0;
+  int       last16    = 0;
+
+  std::fill(pinIndex, pinIndex + 64, -1);
+
+  for (int i = 0; i < 16; i++)
+    pinIndex[pins[i]] = i;
+
+  printf("%s : median edge delay from ISR entry, ns\n", PWM_PIPELINED_ISR ? "pipelined" : "classic");
+
+  for (int e = 0; e < 3; e++)
+  {
+    ESP32_PWM& engine = engines[e];
+
+    for (int i = 0; i < counts[e]; i++)
+      CHECK(engine.setPWM(pins[i], 100 + 7 * i, 10 + 5 * i) >= 0);
+
+    for (int i = 0; i < 16; i++)
+      delays[i].clear();
+
+    // 2s of 20us ticks, the first ones to settle
+    for (uint32_t tick = 0; tick < 100000; tick++)
+    {
+      host_now_us += 20;
+
+      host_edge_hook  = (tick < 100) ? nullptr : edgeHook;
+      host_write_hook = (tick < 100) ? nullptr : writeHook;
+
+      entry = Clock::now();
+      engine.run();
+    }
+
+    host_edge_hook  = nullptr;
+    host_write_hook = nullptr;
+
+    printf("%2d channels :", counts[e]);
+
+    for (int i = 0; i < counts[e]; i++)
+    {
+      CHECK(delays[i].size() > 100);
+
+      if (delays[i].empty())
+        continue;
+
+      int delay = median(delays[i]);
+
+      printf(" %d", delay);
+
+      minDelay = std::min(minDelay, delay);
+      maxDelay = std::max(maxDelay, delay);
+
+      if (counts[e] == 16)
+      {
+        if (i == 0)
+          first16 = delay;
+        else if (i == 15)
+          last16 = delay;
+      }
+    }
+
+    printf("\n");
+  }
+
+  printf("spread %d ns, channel 0 / 15 of 16 : %d / %d ns\n", maxDelay - minDelay, first16, last16);
+
+#if PWM_PIPELINED_ISR
+  // All the edges in the first write, whatever the channel and the number of channels
+  CHECK(maxDelay - minDelay < WRITE_NS);
+#else
+  // Each channel written after the ones before it
+  CHECK(last16 > first16);
+#endif
+
+  return host_result(PWM_PIPELINED_ISR ? "test_jitter_pipelined" : "test_jitter");
+}
@@ -0,0 +1,115 @@
+// PWM_LOG_TO_RING : one record per log call, so lines logged at the same time by several writers stay whole
+#define _PWM_LOGLEVEL_                3
+#define USING_MICROS_RESOLUTION       true
+#define PWM_LOG_TO_RING               true
+#define PWM_LOG_RING_SIZE             1024
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <atomic>
+
+ESP32_PWM ISR_PWM;
+
+struct Capture
+{
+  std::string text;
+
+  template<class T> void print(const T& t)    { std::ostringstream out; out << t; text += out.str(); }
+  void print(const __FlashStringHelper* t)    { text += (const char*) t; }
+  void println()                              { text += '\n'; }
+};
+
+static const uint32_t   lines = 5000;
+static std::atomic<int> writing;
+
+static void writer(const char* labelA, const char* labelB)
+{
+  for (uint32_t i = 0; i < lines; i++)
+  {
+    PWM_LOGINFO_LINE(labelA, i, labelB, 2 * i);
+    std::this_thread::yield();
+  }
+
+  writing--;
+}
+
+int main()
+{
+  Capture out;
+
+  // A channel setup line is one record
+  host_now_us = 1000;
+
+  uint32_t head = PWM_getLogRing().head;
+  int channel   = ISR_PWM.setPWM(2, 100.0f, 25.0f);
+
+  CHECK(channel == 0);
+  CHECK(PWM_getLogRing().head == head + 1);
+
+  PWM_LOGERROR1("Error:", -5);
+
+  PWM_LogRing_dump(out);
+  printf("%s", out.text.c_str());
+
+  CHECK(out.text.find("1000: Channel : 0\t    Period : 10000\t\tOnTime : 2500\tStart_Time : 1000\n") != std::string::npos);
+  CHECK(out.text.find("1000: [PWM] Error: -5\n") != std::string::npos);
+
+  // Two writers, with the reader running at the same time and lapped
+  writing = 2;
+
+  std::thread first(writer, "A : ", "\tB : ");
+  std::thread second(writer, "C : ", "\tD : ");
+
+  uint32_t  printed = 0;
+  uint32_t  whole   = 0;
+  uint32_t  dropped = PWM_LogRing_dropped();
+
+  while (writing || (PWM_getLogRing().tail != PWM_getLogRing().head))
+  {
+    out.text.clear();
+    printed += PWM_LogRing_dump(out);
+
+    std::istringstream text(out.text);
+    std::string        line;
+
+    while (std::getline(text, line))
+    {
+      unsigned long timestamp, a, b;
+      char          labelA, labelB;
+
+      if ( (sscanf(line.c_str(), "%lu: %c : %lu\t%c : %lu", &timestamp, &labelA, &a, &labelB, &b) == 5)
+           && (labelB == labelA + 1) && (b == 2 * a) )
+        whole++;
+      else
+        printf("mixed up line : %s\n", line.c_str());
+    }
+  }
+
+  first.join();
+  second.join();
+
+  dropped = PWM_LogRing_dropped() - dropped;
+
+  printf("%u lines logged, %u printed whole, %u dropped\n", 2 * lines, whole, dropped);
+
+  CHECK(whole == printed);
+  CHECK(printed + dropped == 2 * lines);
+
+  // A full ring keeps the newest records
+  dropped = PWM_LogRing_dropped();
+
+  for (uint32_t i = 0; i < 2 * PWM_LOG_RING_SIZE; i++)
+    PWM_LOGINFO_LINE("A : ", i, "\tB : ", 2 * i);
+
+  out.text.clear();
+
+  CHECK(PWM_LogRing_dump(out) == PWM_LOG_RING_SIZE);
+  CHECK(PWM_LogRing_dropped() - dropped == PWM_LOG_RING_SIZE);
+  CHECK(out.text.find("A : 1024\tB : 2048\n") != std::string::npos);
+
+  return host_result("test_log_ring");
+}
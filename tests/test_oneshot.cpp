@@ -0,0 +1,65 @@
+// A one-shot pulse fires once, then frees its slot. Cancelled by disableAll(), never re-armed by enableAll()
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+#define CHANGING_PWM_END_OF_CYCLE     true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+ESP32_PWM ISR_PWM;
+
+static void simulate(uint32_t us)
+{
+  for (uint64_t end = host_now_us + us; host_now_us < end; host_now_us += 20)
+    ISR_PWM.run();
+}
+
+int main()
+{
+  int channel = ISR_PWM.setPWM(2, 100.0f, 50.0f);
+
+  CHECK(channel >= 0);
+
+  int available = ISR_PWM.getNumAvailablePWMChannels();
+
+  // 1000us from now, 100us wide
+  CHECK(ISR_PWM.firePulseFromISR(5, 1000, 100) >= 0);
+  CHECK(ISR_PWM.getNumAvailablePWMChannels() == available - 1);
+
+  simulate(5000);
+
+  CHECK(host_rise_count[5] == 1);
+  CHECK(host_pin_level[5] == LOW);
+  CHECK(ISR_PWM.getNumAvailablePWMChannels() == available);
+
+  // Cancelled before the pulse : the slot is freed as by a delete
+  int pulse = ISR_PWM.firePulseFromISR(5, 1000, 100);
+
+  CHECK(pulse >= 0);
+
+  ISR_PWM.disableAll();
+  simulate(20000);
+
+  CHECK(host_rise_count[5] == 1);
+  CHECK(ISR_PWM.getNumAvailablePWMChannels() == available);
+
+  ISR_PWM.enableAll();
+  simulate(20000);
+
+  CHECK(host_rise_count[5] == 1);
+  CHECK(ISR_PWM.isEnabled(channel));
+
+  // Not enabled again, even before the pulse is over
+  pulse = ISR_PWM.firePulseFromISR(5, 1000, 100);
+
+  CHECK(!ISR_PWM.enableFromISR(pulse));
+
+  simulate(5000);
+
+  CHECK(host_rise_count[5] == 2);
+  CHECK(ISR_PWM.getNumAvailablePWMChannels() == available);
+
+  printf("%u pulses on the one-shot pin\n", host_rise_count[5]);
+
+  return host_result("test_oneshot");
+}
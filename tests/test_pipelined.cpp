@@ -0,0 +1,224 @@
+// PWM_PIPELINED_ISR : the edges computed by a run() are written by the next one, even when the timer is then paused
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+#define PWM_PIPELINED_ISR             true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+#include <math.h>
+
+ESP32Timer ITimer(0);
+ESP32_PWM  ISR_PWM;
+
+// Without timer, run() called by the test
+ESP32_PWM  LatePWM;
+
+static int      edges;
+static int      edgeLevel[8];
+static uint64_t edgeTime[8];
+
+static void edgeHook(int pin, int level)
+{
+  if ( (pin != 2) || (edges >= 8) )
+    return;
+
+  edgeLevel[edges]  = level;
+  edgeTime[edges++] = host_now_us;
+}
+
+static void runLate(const uint32_t& passes)
+{
+  for (uint32_t i = 0; i < passes; i++)
+  {
+    host_now_us += 20;
+    LatePWM.run();
+  }
+}
+
+static PWM_ChannelState_t lateState(const int& channel)
+{
+  PWM_ChannelState_t state;
+
+  LatePWM.getChannelState(channel, state);
+
+  return state;
+}
+
+bool IRAM_ATTR TimerHandler(void * timerNo)
+{
+  (void) timerNo;
+
+  ISR_PWM.run();
+
+  return true;
+}
+
+// Interrupts raised by the timer in 'us', on a 20us tick
+static uint32_t simulate(const uint64_t& us)
+{
+  uint32_t isrs = 0;
+
+  for (uint64_t end = host_now_us + us; host_now_us < end; )
+  {
+    host_now_us += 20;
+
+    if (host_alarm_value != TIMER_IDLE_ALARM_VALUE)
+    {
+      host_isr_fn(host_isr_arg);
+      isrs++;
+    }
+  }
+
+  return isrs;
+}
+
+int main()
+{
+  host_now_us = 1000000;
+
+  CHECK(ITimer.attachInterruptInterval(20, TimerHandler));
+
+  ISR_PWM.attachTimer(&ITimer);
+
+  // A new 0% channel ends LOW, then the timer pauses
+  int channel = ISR_PWM.setPWM(2, 400.0f, 0.0f);
+
+  CHECK(channel >= 0);
+
+  simulate(10000);
+
+  CHECK(host_pin_level[2] == LOW);
+  CHECK(ISR_PWM.isTimerIdle());
+
+  // From 0% to 100%
+  CHECK(ISR_PWM.modifyPWMChannel(channel, 2, 400.0f, 100.0f));
+
+  simulate(10000);
+
+  CHECK(host_pin_level[2] == HIGH);
+  CHECK(ISR_PWM.isTimerIdle());
+
+  // and back
+  CHECK(ISR_PWM.modifyPWMChannel(channel, 2, 400.0f, 0.0f));
+
+  simulate(10000);
+
+  CHECK(host_pin_level[2] == LOW);
+  CHECK(ISR_PWM.isTimerIdle());
+
+  // Running again after idle gaps : 400 pulses in 1s, and no look-ahead over a gap
+  for (int i = 0; i < 2; i++)
+  {
+    // Back-to-back gaps, with a single run() in between
+    CHECK(ISR_PWM.modifyPWMChannel(channel, 2, 400.0f, 0.0f));
+
+    simulate(1000);
+    CHECK(ISR_PWM.isTimerIdle());
+    simulate(1000);
+
+    CHECK(ISR_PWM.modifyPWMChannel(channel, 2, 400.0f, 50.0f));
+
+    host_rise_count[2] = 0;
+    simulate(1000000);
+
+    printf("after idle : %u pulses, %u overruns\n", host_rise_count[2], ISR_PWM.getOverruns(channel));
+
+    CHECK(host_rise_count[2] >= 399 && host_rise_count[2] <= 401);
+    CHECK(ISR_PWM.getOverruns(channel) == 0);
+
+    // Applied at the end of the current cycle
+    CHECK(ISR_PWM.modifyPWMChannel(channel, 2, 400.0f, 0.0f));
+
+    simulate(5000);
+    CHECK(ISR_PWM.isTimerIdle());
+  }
+
+  // 15 channels, 10s
+  const int pins[] = { 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26, 27 };
+  uint64_t  high[15] = { 0 };
+
+  ISR_PWM.deleteChannel(channel);
+
+  for (int i = 0; i < 15; i++)
+    CHECK(ISR_PWM.setPWM(pins[i], 100 + 7 * i, 10 + 5 * i) >= 0);
+
+  for (int i = 0; i < 15; i++)
+    host_rise_count[pins[i]] = 0;
+
+  for (uint32_t tick = 0; tick < 500000; tick++)
+  {
+    simulate(20);
+
+    for (int i = 0; i < 15; i++)
+      high[i] += host_pin_level[pins[i]] ? 20 : 0;
+  }
+
+  for (int i = 0; i < 15; i++)
+  {
+    double duty = 100.0 * high[i] / 10000000;
+    float  freq = 100 + 7 * i;
+
+    // A plain channel is a little slow, the ISR noticing the end of each cycle up to one tick late
+    CHECK(host_rise_count[pins[i]] >= (uint32_t) (10 * freq * 0.99));
+    CHECK(fabs(duty - (10 + 5 * i)) < 1);
+  }
+
+  CHECK(!ISR_PWM.isTimerIdle());
+
+  // PWM_OVERRUN_MIN_PULSE : the forced edges of a late run() are written by the next one, as all its other edges
+  int late = LatePWM.setPWM(2, 400.0f, 10.0f);
+
+  CHECK(late >= 0);
+
+  LatePWM.setOverrunPolicy(PWM_OVERRUN_MIN_PULSE);
+  runLate(1000);
+
+  // Late while HIGH : the falling edge, one run() later
+  while (!lateState(late).pinHigh)
+    runLate(1);
+
+  runLate(1);
+
+  CHECK(host_pin_level[2] == HIGH);
+
+  edges          = 0;
+  host_edge_hook = edgeHook;
+  host_now_us    += 2500;
+
+  uint64_t lateTime = host_now_us + 20;
+
+  runLate(2);
+
+  printf("missed edge : %d edges, LOW %llu us after the late run()\n", edges, 
+         (unsigned long long) (edgeTime[0] - lateTime));
+
+  CHECK(LatePWM.getOverruns(late) == 1);
+  CHECK(edges == 1 && edgeLevel[0] == LOW && edgeTime[0] == lateTime + 20);
+
+  // Late right after the end of the cycle : the whole lost pulse, one run() later
+  host_edge_hook = nullptr;
+  runLate(1000);
+
+  while (lateState(late).phase < 2500)
+    runLate(1);
+
+  edges          = 0;
+  host_edge_hook = edgeHook;
+  host_now_us    += 2500;
+
+  lateTime = host_now_us + 20;
+
+  runLate(2);
+
+  printf("lost pulse : %d edges, HIGH / LOW %llu / %llu us after the late run()\n", edges, 
+         (unsigned long long) (edgeTime[0] - lateTime), (unsigned long long) (edgeTime[1] - lateTime));
+
+  CHECK(LatePWM.getOverruns(late) == 2);
+  CHECK(edges == 2 && edgeLevel[0] == HIGH && edgeLevel[1] == LOW);
+  CHECK(edgeTime[0] == lateTime + 20 && edgeTime[1] == lateTime + 20);
+
+  host_edge_hook = nullptr;
+
+  return host_result("test_pipelined");
+}
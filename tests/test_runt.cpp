@@ -0,0 +1,74 @@
+// disable(), toggle() and deleteChannel() wait for the end of the current pulse : no runt pulse
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+#define CHANGING_PWM_END_OF_CYCLE     true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+ESP32_PWM ISR_PWM;
+
+int main()
+{
+  // 10000us period, 3000us pulses
+  int channel   = ISR_PWM.setPWM(2, 100.0f, 30.0f);
+  int steady    = ISR_PWM.setPWM(4, 50.0f, 100.0f);
+
+  CHECK(channel >= 0 && steady >= 0);
+
+  int       last    = 0;
+  uint64_t  riseAt  = 0;
+  int       pulses  = 0;
+  int       runts   = 0;
+  unsigned  seed    = 1;
+
+  // 20s with random toggles
+  for (host_now_us = 0; host_now_us < 20000000ULL; host_now_us += 20)
+  {
+    seed = seed * 1103515245 + 12345;
+
+    if ((seed >> 16) % 3000 == 0)
+      ISR_PWM.toggle(channel);
+
+    if ((seed >> 16) % 5000 == 1)
+      ISR_PWM.toggle(steady);
+
+    ISR_PWM.run();
+
+    int level = host_pin_level[2];
+
+    if (level && !last)
+      riseAt = host_now_us;
+    else if (!level && last)
+    {
+      pulses++;
+
+      if (host_now_us - riseAt < 3000)
+        runts++;
+    }
+
+    last = level;
+  }
+
+  printf("%d pulses, %d runts\n", pulses, runts);
+
+  CHECK(pulses > 1000);
+  CHECK(runts == 0);
+
+  // A delete also ends on a LOW pin, and frees the slot
+  int numChannels = ISR_PWM.getnumChannels();
+
+  ISR_PWM.enable(channel);
+  ISR_PWM.deleteChannel(channel);
+
+  for (int i = 0; i < 1000; i++)
+  {
+    host_now_us += 20;
+    ISR_PWM.run();
+  }
+
+  CHECK(ISR_PWM.getnumChannels() == numChannels - 1);
+  CHECK(host_pin_level[2] == LOW);
+
+  return host_result("test_runt");
+}
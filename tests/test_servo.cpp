@@ -0,0 +1,109 @@
+// Servo widths exact to the us with an attached timer, run() moving the next interrupt onto the next servo edge.
+// The timer counts 1 tick per us, and raises its interrupt when the counter reaches the alarm
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+ESP32Timer ITimer(0);
+ESP32_PWM  ISR_PWM;
+
+static const int      pins[4]   = { 2, 4, 5, 12 };
+static const uint16_t widths[4] = { 1234, 1500, 1013, 2000 };
+
+static uint64_t rise[64];
+static uint32_t pulses[64];
+static uint32_t wrong[64];
+static int      expected[64];
+
+bool IRAM_ATTR TimerHandler(void * timerNo)
+{
+  (void) timerNo;
+
+  ISR_PWM.run();
+
+  return true;
+}
+
+static void edgeHook(int pin, int level)
+{
+  if (level)
+  {
+    rise[pin] = host_now_us;
+  }
+  else if (rise[pin])
+  {
+    pulses[pin]++;
+
+    if ( (int) (host_now_us - rise[pin]) != expected[pin])
+    {
+      if (wrong[pin]++ == 0)
+        printf("pin %d : %d us wide instead of %d\n", pin, (int) (host_now_us - rise[pin]), expected[pin]);
+    }
+  }
+}
+
+// Interrupts raised by the timer in 'us'
+static uint32_t simulate(const uint64_t& us)
+{
+  uint32_t isrs = 0;
+
+  for (uint64_t end = host_now_us + us; host_now_us < end; )
+  {
+    host_now_us++;
+
+    if (++host_counter_value >= host_alarm_value)
+    {
+      host_counter_value = 0;
+
+      host_isr_fn(host_isr_arg);
+      isrs++;
+    }
+  }
+
+  return isrs;
+}
+
+int main()
+{
+  CHECK(ITimer.attachInterruptInterval(20, TimerHandler));
+
+  ISR_PWM.attachTimer(&ITimer);
+
+  for (int i = 0; i < 4; i++)
+  {
+    CHECK(ISR_PWM.setServo(pins[i], widths[i]) >= 0);
+    expected[pins[i]] = widths[i];
+  }
+
+  // The first frame to settle
+  simulate(2 * PWM_SERVO_FRAME_US);
+
+  host_edge_hook = edgeHook;
+
+  uint32_t isrs = simulate(1000000);
+
+  host_edge_hook = nullptr;
+
+  printf("%u ISRs in 1s,", isrs);
+
+  for (int i = 0; i < 4; i++)
+    printf(" pin %d : %u pulses %u wrong,", pins[i], pulses[pins[i]], wrong[pins[i]]);
+
+  printf("\n");
+
+  for (int i = 0; i < 4; i++)
+  {
+    CHECK(pulses[pins[i]] >= 49 && pulses[pins[i]] <= 50);
+    CHECK(wrong[pins[i]] == 0);
+  }
+
+  // Still every 20us, plus at most one interrupt per servo edge
+  CHECK(isrs >= 50000 && isrs <= 50000 + 50 * 8);
+
+  // Back to the interval of the timer after the last edge of the frame
+  CHECK(host_alarm_value == ITimer.getTicks());
+
+  return host_result("test_servo");
+}
@@ -0,0 +1,191 @@
+// restoreSnapshot() resumes every channel from its saved phase, and rejects corrupted, short or conflicting snapshots
+#define _PWM_LOGLEVEL_                0
+#define USING_MICROS_RESOLUTION       true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+#include <chrono>
+
+ESP32_PWM Saved;
+ESP32_PWM Restored;
+
+static uint64_t lastRise[64];
+static uint64_t firstRise[64];
+static int      last[64];
+
+typedef std::chrono::steady_clock Clock;
+
+static const int pins16[16] = { 2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26 };
+
+// The 16 channels of the timed section
+static void setPWM16(ESP32_PWM& engine)
+{
+  for (int i = 0; i < 16; i++)
+    engine.setPWM(pins16[i], 100 + 7 * i, 10 + 5 * i);
+}
+
+static double nsSince(const Clock::time_point& start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+static void sample(const bool& restored)
+{
+  for (int pin = 0; pin < 64; pin++)
+  {
+    if (host_pin_level[pin] && !last[pin])
+    {
+      if (!restored)
+        lastRise[pin] = host_now_us;
+      else if (!firstRise[pin])
+        firstRise[pin] = host_now_us;
+    }
+
+    last[pin] = host_pin_level[pin];
+  }
+}
+
+int main()
+{
+  host_now_us = 1000000;
+
+  CHECK(Saved.setPWM(2, 100.0f, 30.0f) >= 0);
+  CHECK(Saved.setPWM_Exact(4, 300.0f, 40.0f) >= 0);
+  CHECK(Saved.setPWM_Dithered(5, 250.0f, 12.5f) >= 0);
+  CHECK(Saved.setPWM_Complementary(12, 13, 200.0f, 50.0f, 100) >= 0);
+
+  int disabled = Saved.setPWM(14, 50.0f, 50.0f);
+  int modified = Saved.setPWM(15, 125.0f, 20.0f);
+
+  CHECK(disabled >= 0 && modified >= 0);
+
+  for (; host_now_us < 1145000; host_now_us++)
+  {
+    Saved.run();
+    sample(false);
+  }
+
+  // The change is still pending at the end of the cycle when saved
+  Saved.disable(disabled);
+  Saved.modifyPWMChannel(modified, 15, 125.0f, 60.0f);
+
+  for (; host_now_us < 1151234; host_now_us++)
+  {
+    Saved.run();
+    sample(false);
+  }
+
+  PWM_ChannelState_t state;
+
+  CHECK(Saved.getChannelState(modified, state) && (state.onTime == 1600));
+
+  uint8_t snapshot[PWM_SNAPSHOT_SIZE(MAX_NUMBER_CHANNELS)];
+  size_t  size      = Saved.saveSnapshot(snapshot, sizeof(snapshot));
+  uint8_t copy[sizeof(snapshot)];
+
+  CHECK(size == PWM_SNAPSHOT_SIZE(6));
+  CHECK(Saved.saveSnapshot(snapshot, size - 1) == 0);
+
+  // After a reset, 1s later
+  const uint64_t gap = 1000000;
+
+  host_now_us += gap;
+
+  memcpy(copy, snapshot, size);
+  copy[30] ^= 1;
+
+  CHECK(Restored.restoreSnapshot(copy, size) == -1);
+  CHECK(Restored.restoreSnapshot(snapshot, size - 1) == -1);
+  CHECK(Restored.getnumChannels() <= 0);
+
+  CHECK(Restored.restoreSnapshot(snapshot, size) == 6);
+
+  // All or nothing, the slots being used
+  CHECK(Restored.restoreSnapshot(snapshot, size) == -1);
+  CHECK(Restored.getnumChannels() == 6);
+
+  CHECK(!Restored.isEnabled(disabled));
+
+  CHECK(Restored.getChannelState(modified, state) && (state.onTime == 4800));
+
+  for (uint64_t start = host_now_us; host_now_us < start + 100000; host_now_us++)
+  {
+    Restored.run();
+    sample(true);
+  }
+
+  // The waveforms of the integer and dithered periods go on as if never stopped, just delayed by the gap
+  const int       pins[]    = { 2, 5, 15 };
+  const int64_t   periods[] = { 10000, 4000, 8000 };
+
+  for (int i = 0; i < 3; i++)
+  {
+    int64_t shift = (int64_t) (firstRise[pins[i]] - lastRise[pins[i]] - gap);
+    int64_t error = ( (shift % periods[i]) + periods[i] + periods[i] / 2 ) % periods[i] - periods[i] / 2;
+
+    printf("pin %d : phase error %lld us\n", pins[i], (long long) error);
+
+    CHECK(firstRise[pins[i]] != 0);
+    CHECK(error == 0);
+  }
+
+  CHECK(firstRise[4] != 0 && firstRise[12] != 0);
+  CHECK(firstRise[14] == 0);
+
+  // Time of restoring 16 channels, against creating them again with setPWM(), each engine fresh and initialised
+  static ESP32_PWM Sixteen;
+
+  setPWM16(Sixteen);
+
+  size = Sixteen.saveSnapshot(snapshot, sizeof(snapshot));
+
+  CHECK(size == PWM_SNAPSHOT_SIZE(16));
+
+  const int iterations  = 2000;
+  double    restoreNs   = 0;
+  double    setPWMNs    = 0;
+  uint32_t  restoreWrites = 0;
+  uint32_t  setPWMWrites  = 0;
+
+  for (int i = 0; i < iterations; i++)
+  {
+    ESP32_PWM* engine = new ESP32_PWM;
+
+    engine->init();
+
+    uint32_t          writes  = host_writes;
+    Clock::time_point start   = Clock::now();
+
+    CHECK(engine->restoreSnapshot(snapshot, size) == 16);
+
+    restoreNs     += nsSince(start);
+    restoreWrites += host_writes - writes;
+
+    delete engine;
+
+    engine = new ESP32_PWM;
+    engine->init();
+
+    writes  = host_writes;
+    start   = Clock::now();
+
+    setPWM16(*engine);
+
+    setPWMNs     += nsSince(start);
+    setPWMWrites += host_writes - writes;
+
+    CHECK(engine->getnumChannels() == 16);
+
+    delete engine;
+  }
+
+  printf("16 channels : restoreSnapshot() %.2f us, %u pin writes, 16 setPWM() %.2f us, %u pin writes\n", 
+         restoreNs / iterations / 1000, restoreWrites / iterations, setPWMNs / iterations / 1000, 
+         setPWMWrites / iterations);
+
+  // All the pins in one masked write
+  CHECK(restoreWrites == (uint32_t) iterations);
+
+  return host_result("test_snapshot");
+}
@@ -0,0 +1,49 @@
+// loadStaticTable() loads a checked table in one pass, and rejects a table built at run time with an invalid entry
+#define _PWM_LOGLEVEL_                0
+#define USING_MICROS_RESOLUTION       true
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+ESP32_PWM ISR_PWM;
+
+PWM_STATIC_TABLE(PWM_Table, PWM_staticChannel(2, 100.0f, 30.0f), PWM_staticChannel(4, 250.0f, 50.0f));
+
+static void simulate(uint32_t us)
+{
+  for (uint64_t end = host_now_us + us; host_now_us < end; host_now_us += 20)
+    ISR_PWM.run();
+}
+
+int main()
+{
+  // Not checked at compile time : out of range frequency, zero period, onTime longer than the period
+  PWM_StaticChannel_t outOfRange[] = { PWM_staticChannel(2, 100.0f, 30.0f), PWM_staticChannel(4, 1000.0f, 50.0f) };
+  PWM_StaticChannel_t zeroPeriod[] = { { 2, true, 0, 0, PWM_GPIO_MASK(2) } };
+  PWM_StaticChannel_t longPulse[]  = { { 2, true, 1000, 2000, PWM_GPIO_MASK(2) } };
+
+  CHECK(ISR_PWM.loadStaticTable(outOfRange) == -1);
+  CHECK(ISR_PWM.loadStaticTable(zeroPeriod) == -1);
+  CHECK(ISR_PWM.loadStaticTable(longPulse) == -1);
+
+  // Nothing loaded, not even the valid entries
+  CHECK(ISR_PWM.getnumChannels() <= 0);
+
+  simulate(100000);
+
+  CHECK(host_rise_count[2] == 0);
+
+  CHECK(ISR_PWM.loadStaticTable(PWM_Table) == 2);
+
+  simulate(1000000);
+
+  printf("%u / %u pulses\n", host_rise_count[2], host_rise_count[4]);
+
+  CHECK(host_rise_count[2] >= 100 && host_rise_count[2] <= 101);
+  CHECK(host_rise_count[4] >= 250 && host_rise_count[4] <= 251);
+
+  // The slots are used now
+  CHECK(ISR_PWM.loadStaticTable(PWM_Table) == -1);
+
+  return host_result("test_static");
+}
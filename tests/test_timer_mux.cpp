@@ -0,0 +1,77 @@
+// The PWM engine as a client of ESP32_TimerMux, on a free-running timer : exact pulse counts, no overrun.
+// TIMER_ISR_LATENCY_HOOK is only called for the reloading timers
+#define _PWM_LOGLEVEL_                1
+#define USING_MICROS_RESOLUTION       true
+
+static volatile int hookCalls = 0;
+
+#define TIMER_ISR_LATENCY_HOOK(ticks)   { (void) (ticks); hookCalls++; }
+
+#include "ESP32_PWM.h"
+#include "host_sim.h"
+
+// 80MHz / 2 : 40 ticks per us
+ESP32Timer      ITimer(1, 2);
+ESP32_TimerMux  TimerMux;
+ESP32_PWM       ISR_PWM;
+
+static int controlCalls = 0;
+
+bool IRAM_ATTR TimerHandler(void * timerNo)
+{
+  (void) timerNo;
+
+  TimerMux.run();
+  return true;
+}
+
+static void IRAM_ATTR ControlLoop(void* arg)
+{
+  (void) arg;
+
+  controlCalls++;
+}
+
+int main()
+{
+  CHECK(TimerMux.begin(&ITimer, TimerHandler));
+
+  // The handler itself, not the latency trampoline, as the counter is never reloaded
+  CHECK(host_isr_fn == TimerHandler);
+  CHECK(!host_auto_reload);
+
+  CHECK(ISR_PWM.setPWM(2, 100.0f, 50.0f) >= 0);
+  CHECK(ISR_PWM.setPWM(9, 500.0f, 25.0f) >= 0);
+
+  CHECK(TimerMux.setInterval(20, ESP32_TimerMux::runPWM, &ISR_PWM) >= 0);
+  CHECK(TimerMux.setInterval(1000, ControlLoop) >= 0);
+
+  // 1s, each interrupt entered 2us after its alarm
+  while (host_counter_value < 40ULL * 1000000)
+  {
+    host_counter_value  = host_alarm_value + 80;
+    host_now_us         = host_counter_value / 40;
+
+    host_isr_fn(host_isr_arg);
+  }
+
+  printf("%u / %u pulses, %d control calls, %u overruns, %u ns max lateness\n", host_rise_count[2],
+         host_rise_count[9], controlCalls, TimerMux.getOverruns(), TimerMux.getMaxLatenessNs());
+
+  CHECK(hookCalls == 0);
+  CHECK(host_rise_count[2] >= 99 && host_rise_count[2] <= 100);
+  CHECK(host_rise_count[9] >= 499 && host_rise_count[9] <= 500);
+  CHECK(controlCalls == 1000);
+  CHECK(TimerMux.getOverruns() == 0);
+
+  // Reloading again once re-attached, with the hook, the counter being the ticks since the alarm
+  CHECK(ITimer.attachInterruptInterval(20, TimerHandler));
+  CHECK(host_auto_reload);
+  CHECK(host_isr_fn != TimerHandler);
+
+  host_isr_fn(host_isr_arg);
+
+  CHECK(hookCalls == 1);
+
+  return host_result("test_timer_mux");
+}